@@ -0,0 +1,161 @@
+/*
+CPU use of the mixer depending on the number of voices.
+
+Looping voices are played on the null sink at real time and the
+CPU time of the process (the stream callback and the refill thread)
+is measured for each number of voices. The null sink ask one block
+of the mixer (256 frames) per stream callback, the CPU use is also
+reported as the time spent per callback. The voices are played at the sample rate of the
+stream, then resampled from 44100Hz.
+
+The CPU time is measured with std::clock, it is the CPU time of the
+process on POSIX systems but the wall time on Windows.
+*/
+
+#include "Mixer.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <thread>
+
+// Sample rate and number of channels of the stream.
+#define STREAM_SAMPLE_RATE 48000
+#define STREAM_CHANNELS 2
+
+// Number of frames asked to the stream callback by the null sink.
+#define CALLBACK_FRAMES 256
+
+// Time played before measuring, the first frames of the voices are read.
+#define WARM_UP_TIME std::chrono::milliseconds(200)
+
+// Time measured for each number of voices.
+#define MEASURE_SECONDS 2
+
+// Largest number of voices, the number of voices is doubled up to it.
+#define MAX_VOICES 64
+
+// Duration of the generated files in seconds.
+#define FILE_DURATION 2
+
+namespace
+{
+void writeLE(std::ofstream& file, uint32_t value, int bytes)
+{
+    for (int b = 0; b < bytes; b++)
+        file.put(static_cast<char>((value >> (8 * b)) & 0xFF));
+}
+
+/*
+Write a stereo 16 bits WAVE file of FILE_DURATION seconds at *sampleRate.
+*/
+bool writeWave(const std::string& filePath, uint32_t sampleRate)
+{
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    const uint16_t blockAlign = STREAM_CHANNELS * 2;
+    const uint32_t dataSize = FILE_DURATION * sampleRate * blockAlign;
+
+    file.write("RIFF", 4);
+    writeLE(file, 36 + dataSize, 4);
+    file.write("WAVEfmt ", 8);
+    writeLE(file, 16, 4);
+    writeLE(file, 1, 2);
+    writeLE(file, STREAM_CHANNELS, 2);
+    writeLE(file, sampleRate, 4);
+    writeLE(file, sampleRate * blockAlign, 4);
+    writeLE(file, blockAlign, 2);
+    writeLE(file, 16, 2);
+    file.write("data", 4);
+    writeLE(file, dataSize, 4);
+
+    // Noise, the content does not matter.
+    uint32_t seed = 1;
+    for (uint32_t i = 0; i < dataSize / 2; i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        writeLE(file, (seed >> 16) & 0x3FFF, 2);
+    }
+    return static_cast<bool>(file);
+}
+
+/*
+Play *voices looping voices of *filePath and measure the CPU use.
+Return the CPU time divided by the time played, or -1 on error.
+*/
+double cpuUse(const std::string& filePath, int voices)
+{
+    SAL::AudioSinkConfig sink;
+    sink.type = SAL::AudioSinkType::NULL_SINK;
+    sink.framesPerBuffer = CALLBACK_FRAMES;
+
+    SAL::Mixer mixer;
+    if (!mixer.open(STREAM_SAMPLE_RATE, STREAM_CHANNELS, sink))
+        return -1.0;
+
+    // Each voice is panned differently, the gains stay below 1.
+    for (int i = 0; i < voices; i++)
+    {
+        float pan = voices > 1 ? -1.0f + 2.0f * i / (voices - 1) : 0.0f;
+        if (mixer.addVoice(filePath, 1.0f / voices, pan, true) < 0)
+            return -1.0;
+    }
+
+    mixer.start();
+    std::this_thread::sleep_for(WARM_UP_TIME);
+
+    std::clock_t cpuStart = std::clock();
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(MEASURE_SECONDS));
+    std::clock_t cpuEnd = std::clock();
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    mixer.close();
+    return (double)(cpuEnd - cpuStart) / CLOCKS_PER_SEC / duration.count();
+}
+}
+
+int main()
+{
+#ifndef USE_WAVE
+    std::printf("The WAVE reader is not compiled, nothing to measure\n");
+    return 0;
+#else
+    const std::string nativeFilePath = "MixerBenchmark48000.wav";
+    const std::string resampledFilePath = "MixerBenchmark44100.wav";
+    if (!writeWave(nativeFilePath, STREAM_SAMPLE_RATE) || !writeWave(resampledFilePath, 44100))
+    {
+        std::printf("Cannot write the files of the voices\n");
+        return 1;
+    }
+
+    const double callbackDuration = (double)CALLBACK_FRAMES / STREAM_SAMPLE_RATE;
+    std::printf("Stream of %d channels at %dHz, callbacks of %d frames (%.2f ms)\n\n",
+        STREAM_CHANNELS, STREAM_SAMPLE_RATE, CALLBACK_FRAMES, callbackDuration * 1000.0);
+    std::printf("%8s %14s %21s %14s %21s\n", "Voices", "CPU 48000Hz", "us/callback 48000Hz", "CPU 44100Hz", "us/callback 44100Hz");
+
+    bool isSuccess = true;
+    for (int voices = 1; voices <= MAX_VOICES; voices *= 2)
+    {
+        double native = cpuUse(nativeFilePath, voices);
+        double resampled = cpuUse(resampledFilePath, voices);
+        if (native < 0.0 || resampled < 0.0)
+        {
+            std::printf("Cannot play %d voices\n", voices);
+            isSuccess = false;
+            break;
+        }
+        std::printf("%8d %13.2f%% %21.1f %13.2f%% %21.1f\n", voices,
+            native * 100.0, native * callbackDuration * 1e6,
+            resampled * 100.0, resampled * callbackDuration * 1e6);
+    }
+
+    std::remove(nativeFilePath.c_str());
+    std::remove(resampledFilePath.c_str());
+    return isSuccess ? 0 : 1;
+#endif
+}
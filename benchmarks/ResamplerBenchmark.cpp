@@ -0,0 +1,142 @@
+/*
+Throughput of the polyphase resampler.
+
+Stereo noise is resampled by blocks, the way the stream converter
+feed the resampler, for each quality and the common ratios. The
+throughput is reported in output channel-samples per second and
+as a multiple of real time.
+*/
+
+#include "Resampler.h"
+#include "SampleConverter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// Duration of the output resampled for each configuration, in seconds.
+#define BENCHMARK_SECONDS 60
+
+// Number of channels resampled.
+#define BENCHMARK_CHANNELS 2
+
+// Number of output frames asked at once, the size of a stream callback.
+#define BLOCK_FRAMES 512
+
+// Number of input frames of noise, read in a loop.
+#define NOISE_FRAMES 65536
+
+namespace
+{
+struct Ratio
+{
+    size_t inSampleRate;
+    size_t outSampleRate;
+};
+
+const Ratio RATIOS[] = {
+    {44100, 48000},
+    {48000, 44100},
+    {44100, 96000},
+    {96000, 48000},
+    {96000, 44100}};
+
+const char* qualityName(SAL::ResamplerQuality quality)
+{
+    switch (quality)
+    {
+    case SAL::ResamplerQuality::FAST:
+        return "FAST";
+    case SAL::ResamplerQuality::MEDIUM:
+        return "MEDIUM";
+    case SAL::ResamplerQuality::BEST:
+        return "BEST";
+    }
+    return "";
+}
+
+const char* instructionsName(SAL::SampleConverter::Instructions instructions)
+{
+    switch (instructions)
+    {
+    case SAL::SampleConverter::Instructions::SCALAR:
+        return "SCALAR";
+    case SAL::SampleConverter::Instructions::SSE2:
+        return "SSE2";
+    case SAL::SampleConverter::Instructions::AVX2:
+        return "AVX2";
+    case SAL::SampleConverter::Instructions::NEON:
+        return "NEON";
+    }
+    return "";
+}
+
+/*
+Resample BENCHMARK_SECONDS seconds of output with *resampler configured for *ratio.
+Return the time spent in seconds.
+*/
+double run(SAL::Resampler& resampler, const Ratio& ratio, const std::vector<float>& noise)
+{
+    std::vector<float> output(BLOCK_FRAMES * BENCHMARK_CHANNELS);
+    const size_t totalFrames = (size_t)BENCHMARK_SECONDS * ratio.outSampleRate;
+    size_t framesWritten = 0;
+    size_t noisePos = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (framesWritten < totalFrames)
+    {
+        size_t frames = std::min<size_t>(BLOCK_FRAMES, totalFrames - framesWritten);
+
+        size_t framesNeeded = std::min(resampler.inputFramesNeeded(frames), resampler.writableFrames());
+        if (noisePos + framesNeeded > NOISE_FRAMES)
+            noisePos = 0;
+        for (int c = 0; c < BENCHMARK_CHANNELS; c++)
+            memcpy(resampler.inputChannel(c), noise.data() + c * NOISE_FRAMES + noisePos, framesNeeded * sizeof(float));
+        resampler.commitInput(framesNeeded);
+        noisePos += framesNeeded;
+
+        framesWritten += resampler.process(output.data(), frames);
+    }
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
+    // Keep the output alive.
+    volatile float sink = output[0];
+    (void)sink;
+    return duration.count();
+}
+}
+
+int main()
+{
+    // Planar noise, one plane per channel.
+    std::vector<float> noise(NOISE_FRAMES * BENCHMARK_CHANNELS);
+    unsigned int seed = 1;
+    for (float& sample : noise)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        sample = (float)(seed >> 8) / (float)(1u << 23) - 1.0f;
+    }
+
+    std::printf("Resampling %d channels, %d seconds per configuration, kernels: %s\n\n",
+        BENCHMARK_CHANNELS, BENCHMARK_SECONDS, instructionsName(SAL::SampleConverter::bestInstructions()));
+    std::printf("%-8s %-14s %8s %22s %14s\n", "Quality", "Ratio", "Taps", "Channel-samples/s", "Real time");
+
+    for (SAL::ResamplerQuality quality : {SAL::ResamplerQuality::FAST, SAL::ResamplerQuality::MEDIUM, SAL::ResamplerQuality::BEST})
+    {
+        for (const Ratio& ratio : RATIOS)
+        {
+            // The filter tables are computed out of the measure.
+            SAL::Resampler resampler;
+            resampler.configure(BENCHMARK_CHANNELS, ratio.inSampleRate, ratio.outSampleRate, quality);
+
+            double seconds = run(resampler, ratio, noise);
+            double channelSamples = (double)BENCHMARK_SECONDS * ratio.outSampleRate * BENCHMARK_CHANNELS;
+            char ratioName[32];
+            std::snprintf(ratioName, sizeof(ratioName), "%zu>%zu", ratio.inSampleRate, ratio.outSampleRate);
+            std::printf("%-8s %-14s %8zu %22.0f %13.0fx\n",
+                qualityName(quality), ratioName, resampler.taps(), channelSamples / seconds, BENCHMARK_SECONDS / seconds);
+        }
+    }
+    return 0;
+}
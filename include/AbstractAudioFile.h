@@ -5,11 +5,15 @@
 #include <string>
 #include <atomic>
 #include <mutex>
+#include <vector>
+#include <memory>
 #include "RingBuffer.h"
 #include "Common.h"
 
 namespace SAL
 {
+class StreamConverter;
+
 /*
 Abstract class to open a file.
 The goal of this class is to have 
@@ -111,10 +115,36 @@ public:
     inline size_t bufferingSize() const noexcept;
 
     /*
-    Return true if the ring buffer is half filled.
+    Return true if the ring buffer reached the high watermark
+    of the buffering policy.
     */
     inline bool isEnoughBuffering() const noexcept;
 
+    /*
+    Return true if the ring buffer is being refilled from the file.
+    The main loop keep reading until the ring buffer is full.
+    */
+    bool isRefilling();
+
+    /*
+    Return true if readFromFile has data to read: the ring buffer
+    is being refilled or it went under the low watermark.
+    */
+    bool isRefillNeeded();
+
+    /*
+    Return true once each time the ring buffer goes under the low watermark.
+    Called by the stream callback to wake up the main loop.
+    */
+    bool isLowWatermarkCrossed() noexcept;
+
+    /*
+    Set the size of the buffers and the watermarks of the file.
+    The size of the buffers is applied on their next allocation,
+    it must be set before the first read from the file.
+    */
+    void setBufferingPolicy(const BufferingPolicy& policy);
+
     /*
     Extract data from the audio files has 32 bits floating point numbers.
     - data = a pointer to an audio buffer.
@@ -123,6 +153,41 @@ public:
     */
     size_t read(char* data, size_t sizeInFrames);
 
+    /*
+    Set the format of the output stream, the frames read with readOutput
+    are resampled and their channels remapped to this format.
+    Nothing is converted if it is the format of the file.
+    - quality = the quality of the resampler.
+    */
+    void setOutputFormat(int numChannels, size_t sampleRate, ResamplerQuality quality = ResamplerQuality::MEDIUM);
+
+    /*
+    Same as read, but the frames are in the output format.
+    - sizeInFrames = the size of the buffers in frames of the output format.
+    */
+    size_t readOutput(char* data, size_t sizeInFrames);
+
+    /*
+    Return the number of frames left to read with readOutput,
+    in frames of the output format.
+    */
+    size_t remainingOutputFrames() const noexcept;
+
+    /*
+    Decode up to *frames frames from the stream position directly into
+    *output as interleaved 32 bits floating point numbers. The temporary
+    buffer and the ring buffer are not used and nothing is locked, the
+    file must not be streamed at the same time.
+    Return the number of frames decoded, less than *frames at the end of the stream.
+    */
+    size_t decode(float* output, size_t frames);
+
+    /*
+    Move the stream position used by decode to *pos (in frames).
+    Return false if the position is not valid.
+    */
+    bool decodeSeek(size_t pos);
+
     /*
     Return the position in the raw stream in frames.
     */
@@ -188,8 +253,10 @@ protected:
     /*
     Insert data into the tmp buffer.
     The data is converted to 32 bits floating point number.
+    When the tmp buffer is empty, the data is converted
+    directly into the ring buffer.
     */
-    void insertDataInfoTmpBuffer(char* buffer, size_t size);
+    void insertDataInfoTmpBuffer(const char* buffer, size_t size);
 
     /*
     Getting the size of data writen into the temporary buffer.
@@ -229,14 +296,30 @@ protected:
     /*
     Update the buffers size when the 
     audio file header is readed.
+    The buffers are only allocated on the first read from
+    the file, *extraFrames is the number of frames the decoder
+    may write past the minimum size of the temporary buffer.
     */
-    void updateBuffersSize();
+    void updateBuffersSize(size_t extraFrames = 0);
 
     /*
     Minimum size recommanded for the temporary buffer.
     */
     inline size_t minimumSizeTemporaryBuffer() const noexcept;
 
+    /*
+    Size in bytes of raw data to read from the file to fill the
+    temporary buffer up to its minimum size. Always whole frames.
+    */
+    inline size_t readSizeFromFile() const noexcept;
+
+    /*
+    Return a buffer owned by the file of at least *size bytes,
+    used to read raw data before converting it. The buffer only
+    grow, no allocation is done once it is big enough.
+    */
+    char* rawBuffer(size_t size);
+
     /*
     No more data to read.
     */
@@ -285,6 +368,41 @@ private:
     */
     void resizeTmpBuffer(size_t size);
 
+    /*
+    Compute the size of the buffers and the watermarks
+    in bytes from the buffering policy.
+    */
+    void updatePlannedSizes();
+
+    /*
+    Convert a duration in milliseconds into a size in bytes
+    of whole frames of the 32 bits floating point stream.
+    */
+    size_t millisecondsToBytes(size_t ms) const;
+
+    /*
+    Allocate the temporary buffers and the ring buffer
+    with the size set by updateBuffersSize, if not already allocated.
+    */
+    void allocateBuffers();
+
+    /*
+    Release the temporary buffer and the raw buffer.
+    */
+    void releaseTmpBuffers();
+
+    /*
+    Convert *samples samples of the raw stream from *buffer
+    into 32 bits floating point numbers into *output.
+    */
+    void convertToFloat(const char* buffer, float* output, size_t samples) const;
+
+    /*
+    Convert *samples samples of the raw stream from *buffer into the output
+    of decode, the samples past the output are kept for the next call.
+    */
+    void insertDecodedData(const char* buffer, size_t samples);
+
     std::string m_filePath;
     bool m_isOpen;
 
@@ -303,6 +421,40 @@ private:
     size_t m_tmpSizeDataWritten;
     size_t m_tmpSize;
     size_t m_tmpMinimumSize;
+    // Size of the buffers allocated on the first read.
+    size_t m_tmpPlannedSize;
+    size_t m_ringBufferPlannedSize;
+    // Frames the decoder may write past the temporary buffer.
+    size_t m_extraFrames;
+
+    // Buffering policy and the watermarks in bytes.
+    BufferingPolicy m_bufferingPolicy;
+    std::atomic<size_t> m_lowWatermarkSize;
+    std::atomic<size_t> m_highWatermarkSize;
+    // Is the ring buffer being refilled (between the low watermark and full).
+    bool m_isRefilling;
+    // Is the low watermark crossing not reported yet to the main loop.
+    std::atomic<bool> m_isLowWatermarkArmed;
+
+    // Raw data read from the file, waiting to be converted.
+    std::vector<char> m_rawBuffer;
+
+    // Conversion to the output format, nullptr if the formats are the same.
+    std::unique_ptr<StreamConverter> m_converter;
+    // Sample rate of the output format, 0 if not converting.
+    std::atomic<size_t> m_outputSampleRate;
+
+    /*
+    Direct decoding: the output of decode, its size and the number
+    of samples written. The decoders may produce more samples than
+    asked (a whole FLAC block), they are kept in the overflow buffer.
+    */
+    bool m_isDecoding;
+    float* m_decodeOutput;
+    size_t m_decodeSamples;
+    size_t m_decodeWritten;
+    std::vector<float> m_decodeOverflow;
+    size_t m_decodeOverflowPos;
 
     // Ring buffer
     RingBuffer m_ringBuffer;
@@ -326,11 +478,14 @@ private:
     size_t m_startDataPos;
 
     // Indicate no more data need to be readed.
-    bool m_endFile;
+    std::atomic<bool> m_endFile;
 
     // Is the stream has reached the end.
     std::atomic<bool> m_isEnded;
 
+    // The converter still keep frames of the stream after its end.
+    std::atomic<bool> m_isOutputPending;
+
     // Streaming pos from audio file.
     size_t m_readPos;
 };
@@ -353,10 +508,11 @@ inline bool AbstractAudioFile::isOpen() const noexcept
 
 /*
 Is the stream has reached the end.
+When converting, the frames kept by the converter must be read too.
 */
 inline bool AbstractAudioFile::isEnded() const noexcept
 {
-    return m_isEnded;
+    return m_isEnded && !m_isOutputPending;
 }
 
 /*
@@ -523,6 +679,28 @@ inline size_t AbstractAudioFile::minimumSizeTemporaryBuffer() const noexcept
     return m_tmpMinimumSize - m_tmpTailPos;
 }
 
+/*
+Size in bytes of raw data to read from the file to fill the
+temporary buffer up to its minimum size. Always whole frames.
+*/
+inline size_t AbstractAudioFile::readSizeFromFile() const noexcept
+{
+    if (m_numChannels <= 0)
+        return 0;
+    // When decoding directly, the remaining frames of the output, at most a temporary buffer at once.
+    if (m_isDecoding)
+    {
+        size_t frames = (m_decodeSamples - m_decodeWritten) / m_numChannels;
+        size_t maxFrames = m_tmpMinimumSize / streamBytesPerFrame();
+        if (maxFrames > 0 && frames > maxFrames)
+            frames = maxFrames;
+        return frames * m_bytesPerSample * m_numChannels;
+    }
+    if (m_tmpWritePos >= m_tmpMinimumSize)
+        return 0;
+    return (m_tmpMinimumSize - m_tmpWritePos) / streamBytesPerFrame() * m_bytesPerSample * m_numChannels;
+}
+
 /*
 No more data to read.
 */
@@ -554,11 +732,12 @@ inline size_t AbstractAudioFile::bufferingSize() const noexcept
 }
 
 /*
-Return true if the ring buffer is half filled.
+Return true if the bytes currently buffered are at least the high watermark.
 */
 inline bool AbstractAudioFile::isEnoughBuffering() const noexcept
 {
-    return m_ringBuffer.readable() >= (m_ringBuffer.size() / 2l);
+    // The watermark is zero until the buffers size is computed.
+    return m_ringBufferPlannedSize > 0 && m_ringBuffer.readable() >= m_highWatermarkSize;
 }
 
 /*
@@ -0,0 +1,131 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_ACTIVELIST_H_
+#define SIMPLE_AUDIO_LIBRARY_ACTIVELIST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace SAL
+{
+/*
+List published by a writer thread to a real-time reader thread.
+
+The writer build a new list and swap it with the current one,
+the reader only load the pointer of the current list. The reader
+never lock, allocate or wait.
+
+The reader increment an epoch counter when entering and leaving
+a read section, the epoch is odd while the reader is using a list.
+After swapping the list, the writer wait until the reader leave
+the section in progress, the previous list is no longer used and
+is deleted. The items given to the reader (the files) can be
+deleted the same way once they are removed from the list.
+
+Only one reader and one writer at a time.
+*/
+template<typename T>
+class ActiveList
+{
+    ActiveList(const ActiveList&) = delete;
+    ActiveList& operator=(const ActiveList&) = delete;
+
+public:
+    /*
+    Read section of the reader thread, the list is valid
+    until the section is destroyed.
+    */
+    class ReadSection
+    {
+        ReadSection(const ReadSection&) = delete;
+        ReadSection& operator=(const ReadSection&) = delete;
+
+    public:
+        inline ReadSection(ActiveList& list) noexcept;
+        inline ~ReadSection();
+
+        inline const std::vector<T>& items() const noexcept;
+
+    private:
+        ActiveList& m_list;
+        const std::vector<T>* m_items;
+    };
+
+    ActiveList();
+    ~ActiveList();
+
+    /*
+    Replace the list read by the reader and wait
+    until the previous list is no longer used.
+    Only the writer thread can call this method.
+    */
+    void publish(std::vector<T> items);
+
+    /*
+    Wait until the reader leave the read section in progress.
+    The read sections started after the call see every
+    change made before the call.
+    */
+    void synchronize() const;
+
+private:
+    std::atomic<const std::vector<T>*> m_current;
+    std::atomic<uint64_t> m_readerEpoch;
+};
+
+template<typename T>
+inline ActiveList<T>::ReadSection::ReadSection(ActiveList& list) noexcept :
+    m_list(list)
+{
+    // The writer see the odd epoch or the reader see the new list.
+    m_list.m_readerEpoch.fetch_add(1);
+    m_items = m_list.m_current.load();
+}
+
+template<typename T>
+inline ActiveList<T>::ReadSection::~ReadSection()
+{
+    m_list.m_readerEpoch.fetch_add(1, std::memory_order_release);
+}
+
+template<typename T>
+inline const std::vector<T>& ActiveList<T>::ReadSection::items() const noexcept
+{
+    return *m_items;
+}
+
+template<typename T>
+ActiveList<T>::ActiveList() :
+    m_current(new std::vector<T>()),
+    m_readerEpoch(0)
+{}
+
+template<typename T>
+ActiveList<T>::~ActiveList()
+{
+    delete m_current.load();
+}
+
+template<typename T>
+void ActiveList<T>::publish(std::vector<T> items)
+{
+    const std::vector<T>* previous = m_current.exchange(new std::vector<T>(std::move(items)));
+    synchronize();
+    delete previous;
+}
+
+template<typename T>
+void ActiveList<T>::synchronize() const
+{
+    const uint64_t epoch = m_readerEpoch.load();
+    // No read section in progress.
+    if ((epoch & 1) == 0)
+        return;
+
+    // A read section last at most one buffer of the stream.
+    while (m_readerEpoch.load(std::memory_order_acquire) == epoch)
+        std::this_thread::yield();
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_ACTIVELIST_H_
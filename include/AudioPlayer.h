@@ -12,21 +12,34 @@
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <vector>
+#include <atomic>
 
 namespace SAL
 {
+class ThreadPool;
+
 /*
 This is the main class of the simple-audio-libray.
 This is the interface that control the library.
 Initializing this class will start a main loop
 inside another thread which you can communicate with
 the methods inside this class.
+
+Several players can run at the same time, each one with
+its own main loop, stream, events and callbacks, to play on
+several outputs. The files of every player are read on a
+decode pool shared by all the players.
 */
 class SAL_EXPORT_DLL AudioPlayer
 {
     AudioPlayer(const AudioPlayer&) = delete;
-    AudioPlayer();
 public:
+    /*
+    Create a player independent from the instance
+    returned by the instance static method.
+    */
+    AudioPlayer();
     ~AudioPlayer();
 
     /*
@@ -40,7 +53,7 @@ public:
     static std::string version();
 
     /*
-    Create or return the existing instance
+    Create or return the default instance
     of the AudioPlayer class. The instance
     is deleted by itself.
     */
@@ -52,7 +65,7 @@ public:
     inline CallbackInterface& callback() noexcept;
 
     /*
-    Destroy the instance (if one is existing).
+    Destroy the default instance (if one is existing).
     */
     static void deinit();
 
@@ -175,6 +188,64 @@ public:
     */
     std::vector<BackendAudio> availableBackendAudio() const;
 
+    /*
+    Set the buffering policy: the size of the buffers, the watermarks
+    and the number of files buffered ahead. Lower values use less memory,
+    higher values resist better to slow storage.
+    The size of the buffers is applied to the files not yet streamed.
+    */
+    inline void setBufferingPolicy(const BufferingPolicy& policy);
+
+    /*
+    Return the buffering policy.
+    */
+    inline BufferingPolicy bufferingPolicy() const;
+
+    /*
+    Return the number of events received and the number of
+    events coalesced (superseded by a later event) by the main loop.
+    */
+    inline EventStatistics eventStatistics() const;
+
+    /*
+    Set the output of the audio stream: PortAudio, a null sink discarding
+    the audio or a WAVE file. The null and WAVE file sinks are driven by
+    a clock running at the speed given in the config (0 for as fast as possible),
+    no audio device is needed. Applied the next time a stream is created.
+    */
+    inline void setAudioSink(const AudioSinkConfig& config);
+
+    /*
+    Return the output of the audio stream.
+    */
+    inline AudioSinkConfig audioSink() const;
+
+    /*
+    Set the format of the output stream. By default, the files of
+    another format than the first file of the stream are resampled
+    and their channels remapped, the stream is not recreated and
+    the playlists of mixed formats are played gaplessly.
+    Applied the next time a stream is created.
+    */
+    inline void setOutputFormat(const OutputFormat& format);
+
+    /*
+    Return the format of the output stream.
+    */
+    inline OutputFormat outputFormat() const;
+
+    /*
+    Set the crossfade between the end of a file and the start of the
+    next file of the queue, applied immediately. The next file is
+    already opened and buffered, the crossfade do not wait for it.
+    */
+    inline void setCrossfade(const CrossfadeConfig& config);
+
+    /*
+    Return the crossfade between the files of the queue.
+    */
+    inline CrossfadeConfig crossfade() const;
+
 private:
     /*
     Initialize portaudio and Player interface.
@@ -185,7 +256,9 @@ private:
     This loop is executed in another thread
     and wait until the user want the api to stop.
     The loop process every event and send them to
-    the Player and update the audio buffers.
+    the Player, the audio buffers are refilled on
+    the decode pool.
+    Between iterations, the loop sleep until it is woken up.
     */
     void loop();
 
@@ -194,12 +267,26 @@ private:
     */
     void processEvents();
 
+    /*
+    Replace by INVALID the events superseded by a later event:
+    the seeks and the play/pause followed by another one without
+    any other event in between. Return the number of events replaced.
+    */
+    static size_t coalesceEvents(std::vector<EventData>& events);
+
     /*
     Wait until the next iteration of the main loop to be sure
     the player had time to start playing.
     */
     void waitEvent();
 
+    /*
+    Return the decode pool shared by the players,
+    it is created with the first player and
+    destroyed with the last one.
+    */
+    static std::shared_ptr<ThreadPool> sharedDecodePool();
+
     /*
     The thread where the loop is executed.
     */
@@ -208,10 +295,11 @@ private:
     std::condition_variable m_cvInit;
 
     bool m_isInit;
-    bool m_isRunning;
-    // Time in milliseconds the loop will wait after each iteration.
-    std::atomic<int> m_sleepTime;
+    std::atomic<bool> m_isRunning;
     std::unique_ptr<PortAudioRAII> m_pa;
+    // Reading the files of the player, it must outlive the player.
+    std::shared_ptr<ThreadPool> m_decodePool;
+    // Destroyed first by the destructor, it is using m_events and m_callbackInterface.
     std::unique_ptr<Player> m_player;
 
     /*
@@ -221,18 +309,19 @@ private:
     */
     EventList m_events;
 
+    // Events drained from the event list, processed in one batch.
+    std::vector<EventData> m_pendingEvents;
+    std::atomic<size_t> m_receivedEvents;
+    std::atomic<size_t> m_coalescedEvents;
+
     /*
     A callback list to store user defined callback.
-    It also store a list of call event to be process
-    by the main loop.
+    The callbacks are called from its own dispatcher thread.
     */
     CallbackInterface m_callbackInterface;
 
     /*
-    Only one instance of AudioPlayer is possible.
-    To prevent the user to create multiple instance,
-    the constructor is private and only a static class
-    allow him to retrieve the instance.
+    The default instance is retrieved with the instance static method.
     To prevent both the user and the smart_pointer to delete
     the instance, the destructor of the object release the
     ptr of the smart_pointer if the user delete it.
@@ -283,7 +372,7 @@ inline size_t AudioPlayer::streamPos(TimeType timeType) const noexcept
 }
 
 /*
-Create or return the existing instance
+Create or return the default instance
 of the AudioPlayer class. The instance
 is deleted by itself, do not destroy it
 by yourself, use the deinit method.
@@ -407,6 +496,54 @@ inline BackendAudio AudioPlayer::getBackendAudio() const
 {
     return m_player->getBackendAudio();
 }
+
+inline void AudioPlayer::setBufferingPolicy(const BufferingPolicy& policy)
+{
+    m_player->setBufferingPolicy(policy);
+}
+
+inline BufferingPolicy AudioPlayer::bufferingPolicy() const
+{
+    return m_player->bufferingPolicy();
+}
+
+inline EventStatistics AudioPlayer::eventStatistics() const
+{
+    EventStatistics statistics;
+    statistics.received = m_receivedEvents;
+    statistics.coalesced = m_coalescedEvents;
+    return statistics;
+}
+
+inline void AudioPlayer::setAudioSink(const AudioSinkConfig& config)
+{
+    m_player->setAudioSink(config);
+}
+
+inline AudioSinkConfig AudioPlayer::audioSink() const
+{
+    return m_player->audioSink();
+}
+
+inline void AudioPlayer::setOutputFormat(const OutputFormat& format)
+{
+    m_player->setOutputFormat(format);
+}
+
+inline OutputFormat AudioPlayer::outputFormat() const
+{
+    return m_player->outputFormat();
+}
+
+inline void AudioPlayer::setCrossfade(const CrossfadeConfig& config)
+{
+    m_player->setCrossfade(config);
+}
+
+inline CrossfadeConfig AudioPlayer::crossfade() const
+{
+    return m_player->crossfade();
+}
 }
 
 #endif // SIMPLE_AUDIO_LIBRARY_AUDIOPLAYER_H_
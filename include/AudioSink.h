@@ -0,0 +1,89 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_AUDIOSINK_H_
+#define SIMPLE_AUDIO_LIBRARY_AUDIOSINK_H_
+
+#include "Common.h"
+#include <string>
+#include <cstddef>
+
+namespace SAL
+{
+/*
+Output of the Player stream.
+
+The sink pull the audio from the stream callback, from its own
+thread, until the callback return COMPLETE or the sink is stopped.
+When the sink become inactive, the finished callback is called.
+
+The stream is always 32 bits floating point numbers.
+*/
+class SAL_EXPORT_DLL AudioSink
+{
+    AudioSink(const AudioSink& other) = delete;
+public:
+    enum class StreamResult
+    {
+        // Keep calling the stream callback.
+        CONTINUE,
+        // Not enough audio, the end of the buffer is silence.
+        BUFFERING,
+        // End of the stream, the sink stop after this buffer.
+        COMPLETE
+    };
+
+    /*
+    Fill *output with *frames frames. *framesWritten is set to the
+    number of frames of audio, the remaining frames are silence.
+    */
+    typedef StreamResult (*StreamCallback)(
+        void* output,
+        unsigned long frames,
+        unsigned long& framesWritten,
+        void* data);
+    typedef void (*FinishedCallback)(void* data);
+
+    AudioSink();
+    virtual ~AudioSink();
+
+    /*
+    Create the sink described by *config.
+    hostApiType: PortAudio host API type used by the PortAudio sink.
+    */
+    static AudioSink* create(const AudioSinkConfig& config, int hostApiType);
+
+    /*
+    Prepare the sink for a stream of *numChannels at *sampleRate.
+    */
+    virtual bool open(
+        int numChannels,
+        size_t sampleRate,
+        StreamCallback streamCallback,
+        FinishedCallback finishedCallback,
+        void* data) = 0;
+
+    /*
+    Start calling the stream callback.
+    */
+    virtual bool start() = 0;
+
+    /*
+    Stop calling the stream callback. Return once
+    the stream callback is not called anymore.
+    */
+    virtual void stop() = 0;
+
+    /*
+    Description of the last error.
+    */
+    inline const std::string& lastError() const noexcept;
+
+protected:
+    std::string m_lastError;
+};
+
+inline const std::string& AudioSink::lastError() const noexcept
+{
+    return m_lastError;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_AUDIOSINK_H_
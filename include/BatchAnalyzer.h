@@ -0,0 +1,142 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_BATCHANALYZER_H_
+#define SIMPLE_AUDIO_LIBRARY_BATCHANALYZER_H_
+
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace SAL
+{
+class ThreadPool;
+
+/*
+Result of the analysis of a file.
+- filePath: path of the file.
+- isValid: false if the file cannot be decoded, error tell why.
+- type: format of the file.
+- sampleRate, numChannels: stream informations.
+- frames: number of frames decoded.
+- duration: duration in seconds.
+- peaks: highest absolute sample of each channel.
+- rms: root mean square of each channel.
+- checksum: 64 bits FNV-1a hash of the decoded 32 bits floating point samples.
+*/
+struct SAL_EXPORT_DLL AnalysisResult
+{
+    std::string filePath;
+    bool isValid = false;
+    std::string error;
+    FileType type = UNKNOWN_FILE;
+    size_t sampleRate = 0;
+    int numChannels = 0;
+    size_t frames = 0;
+    double duration = 0.0;
+    std::vector<float> peaks;
+    std::vector<float> rms;
+    uint64_t checksum = 0;
+};
+
+/*
+Decode and analyze many files in parallel.
+
+The files are decoded by the workers of a work-stealing thread pool,
+each worker decode one file at a time by blocks of a fixed size, the
+memory used does not depend on the size of the files. The format is
+detected from the magic bytes before decoding, the files not readable
+by the library are rejected without being decoded.
+*/
+class SAL_EXPORT_DLL BatchAnalyzer
+{
+    BatchAnalyzer(const BatchAnalyzer& other) = delete;
+    BatchAnalyzer& operator=(const BatchAnalyzer& other) = delete;
+public:
+    typedef std::function<void(const AnalysisResult&)> ResultCallback;
+    typedef std::function<void()> FinishedCallback;
+
+    /*
+    Create the analyzer with *threadCount workers,
+    0 for one per hardware thread.
+    */
+    BatchAnalyzer(int threadCount = 0);
+
+    /*
+    Cancel the remaining files and wait for the workers.
+    */
+    ~BatchAnalyzer();
+
+    /*
+    Set the callback receiving the result of each file. It is called
+    from the workers, one call at a time.
+    */
+    void setResultCallback(ResultCallback callback);
+
+    /*
+    Set the callback called from a worker
+    when every submitted file is analyzed.
+    */
+    void setFinishedCallback(FinishedCallback callback);
+
+    /*
+    Add the files *filePaths to analyze and return immediately.
+    Can be called while files are analyzed.
+    */
+    void analyze(const std::vector<std::string>& filePaths);
+
+    /*
+    Wait until every submitted file is analyzed.
+    */
+    void wait();
+
+    /*
+    Skip the files not analyzed yet and stop the files being
+    analyzed. Their results are not sent.
+    */
+    void cancel();
+
+    /*
+    Number of files submitted and not analyzed yet.
+    */
+    inline size_t pendingFiles() const noexcept;
+
+    /*
+    Decode and analyze the file *filePath in the calling thread.
+    */
+    static AnalysisResult analyzeFile(const std::string& filePath);
+
+private:
+    /*
+    Analyze a file on a worker and send the result.
+    */
+    void runTask(const std::string& filePath);
+
+    /*
+    Decode and analyze the file, stop early if *isCancelled is set.
+    */
+    static AnalysisResult analyzeFile(const std::string& filePath, const std::atomic<bool>* isCancelled);
+
+    std::unique_ptr<ThreadPool> m_pool;
+
+    ResultCallback m_resultCallback;
+    FinishedCallback m_finishedCallback;
+    std::mutex m_callbackMutex;
+
+    std::atomic<size_t> m_pendingFiles;
+    std::atomic<bool> m_isCancelled;
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitCV;
+};
+
+inline size_t BatchAnalyzer::pendingFiles() const noexcept
+{
+    return m_pendingFiles;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_BATCHANALYZER_H_
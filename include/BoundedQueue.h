@@ -0,0 +1,150 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_BOUNDEDQUEUE_H_
+#define SIMPLE_AUDIO_LIBRARY_BOUNDEDQUEUE_H_
+
+#include <cstddef>
+#include <atomic>
+#include <memory>
+
+namespace SAL
+{
+/*
+Bounded lock-free multi-producer/multi-consumer queue.
+
+The capacity is rounded up to a power of two. Every cell have a
+sequence number telling if it is ready to be written or read for
+the current lap, producers and consumers are only reserving a
+position with a compare and exchange, they never wait on each other.
+When the queue is full, push fail instead of blocking.
+
+The values are stored in preallocated cells, pushing a value is a copy
+into the cell, there is no allocation if the copy do not allocate.
+*/
+template<typename T>
+class BoundedQueue
+{
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+public:
+    BoundedQueue(size_t capacity);
+
+    /*
+    Copy *value into the queue.
+    Return false if the queue is full.
+    */
+    bool push(const T& value);
+
+    /*
+    Move the oldest value into *value.
+    Return false if the queue is empty.
+    */
+    bool pop(T& value);
+
+    /*
+    Return true if no value is pushed or being pushed.
+    */
+    inline bool empty() const noexcept;
+
+    inline size_t capacity() const noexcept;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+
+    // Producers and consumers positions, on their own cache line.
+    alignas(64) std::atomic<size_t> m_enqueuePos;
+    alignas(64) std::atomic<size_t> m_dequeuePos;
+};
+
+template<typename T>
+BoundedQueue<T>::BoundedQueue(size_t capacity) :
+    m_mask(0),
+    m_enqueuePos(0),
+    m_dequeuePos(0)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+
+    m_cells.reset(new Cell[size]);
+    m_mask = size - 1;
+    for (size_t i = 0; i < size; i++)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+template<typename T>
+bool BoundedQueue<T>::push(const T& value)
+{
+    Cell* cell;
+    size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        // The cell is free for this lap.
+        if (sequence == pos)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1))
+                break;
+        }
+        // The cell still hold the value of the previous lap.
+        else if (sequence < pos)
+            return false;
+        else
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+    }
+
+    cell->value = value;
+    // Publish the value to the consumers.
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool BoundedQueue<T>::pop(T& value)
+{
+    Cell* cell;
+    size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+    while (true)
+    {
+        cell = &m_cells[pos & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        // The value of this lap is published.
+        if (sequence == pos + 1)
+        {
+            if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        // No value published yet.
+        else if (sequence < pos + 1)
+            return false;
+        else
+            pos = m_dequeuePos.load(std::memory_order_relaxed);
+    }
+
+    value = std::move(cell->value);
+    // Free the cell for the next lap.
+    cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+inline bool BoundedQueue<T>::empty() const noexcept
+{
+    return m_enqueuePos.load() == m_dequeuePos.load();
+}
+
+template<typename T>
+inline size_t BoundedQueue<T>::capacity() const noexcept
+{
+    return m_mask + 1;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_BOUNDEDQUEUE_H_
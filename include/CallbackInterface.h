@@ -2,19 +2,27 @@
 #define SIMPLE_AUDIO_LIBRARY_STREAM_CALLBACK_H_
 
 #include "Common.h"
+#include "BoundedQueue.h"
 #include <string>
 #include <functional>
 #include <vector>
+#include <memory>
 #include <variant>
-#include <list>
 #include <mutex>
 #include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <chrono>
 
 namespace SAL
 {
 /*
 This class store the callbacks to notify the user
 of any change in the stream.
+
+The calls are pushed into a bounded lock-free queue, from the main
+loop or the stream callback, and the callbacks are called from a
+dispatcher thread. A slow callback is not delaying the main loop.
 */
 class SAL_EXPORT_DLL CallbackInterface
 {
@@ -23,8 +31,6 @@ class SAL_EXPORT_DLL CallbackInterface
         UNKNOWN,
         START_FILE,
         END_FILE,
-        STREAM_POS_CHANGE_IN_FRAME,
-        STREAM_POS_CHANGE,
         STREAM_PAUSED,
         STREAM_PLAYING,
         STREAM_STOPPING,
@@ -109,6 +115,14 @@ public:
     */
     void addStreamEnoughBufferingCallback(StreamEnoughBufferingCallback callback);
 
+    /*
+    Set how many times per second the stream position callbacks
+    can be called (30 by default). The callbacks are only called
+    when the position changed.
+    */
+    void setStreamPosChangeFrequency(int frequency);
+    inline int streamPosChangeFrequency() const noexcept;
+
     /*
     Add is ready changed callback.
     This callback is called whenever the isReady is called.
@@ -118,22 +132,26 @@ public:
 private:
     /*
     Calling start file callback.
-    This event is store inside a list and is then call
-    from the main loop of the AudioPlayer class.
+    This event is store inside the callback queue and is then call
+    from the dispatcher thread.
     */
     void callStartFileCallback(const std::string& filePath);
 
     /*
     Calling end file callback.
-    This event is store inside a list and is then call
-    from the main loop of the AudioPlayer class.
+    This event is store inside the callback queue and is then call
+    from the dispatcher thread.
     */
     void callEndFileCallback(const std::string& filePath);
 
     /*
-    Calling stream position (in frames or seconds) change callback.
+    Store the latest position of the stream, the dispatcher thread
+    read it at the stream position change frequency and call the
+    stream position callbacks (in frames and in seconds).
+    Called from the stream callback, it is wait-free unless the
+    dispatcher is sleeping without any position pending.
     */
-    void callStreamPosChangeCallback(size_t streamPos, TimeType timeType = TimeType::SECONDS);
+    void setStreamPos(size_t streamPos, size_t sampleRate);
 
     /*
     Calling stream paused callback.
@@ -166,9 +184,39 @@ private:
     void callIsReadyChangedCallback(bool isReady);
 
     /*
-    Call every callback inside the callback queue.
+    Push a callback call into the callback queue and
+    wake up the dispatcher thread. If the queue is full,
+    the call is stored in the overflow list.
     */
-    void callback();
+    void pushCallbackCall(const CallbackData& data);
+
+    /*
+    Loop of the dispatcher thread, calling the callbacks
+    of the callback queue until the interface is destroyed.
+    */
+    void dispatcherLoop();
+
+    /*
+    Dispatch the calls of the callback queue,
+    then the calls of the overflow list.
+    */
+    void dispatchCallbackCalls();
+
+    /*
+    Call the callbacks of a callback call.
+    */
+    void dispatch(const CallbackData& data);
+
+    /*
+    Call the stream position callbacks if the
+    position changed since the last call.
+    */
+    void dispatchStreamPos();
+
+    /*
+    Wake up the dispatcher thread if it is waiting.
+    */
+    void notifyDispatcher();
 
     /*
     Calling the callback of every type of callback.
@@ -190,28 +238,25 @@ private:
     */
     void setIsReadyGetter(std::function<bool()> getter);
 
-    // Call is ready callback thread instance.
-    std::vector<std::thread> m_backgroundThread;
-    std::mutex m_backgroundThreadMutex;
-
     // Making the AudioPlayer and Player class a friend of this class.
     friend class AudioPlayer;
     friend class Player;
 
     /*
-    Vector storing user defined callback.
+    Vector storing user defined callback. The vectors are
+    never modified, they are replaced when a callback is added.
     */
 
-    std::vector<StartFileCallback> m_startFileCallback;
-    std::vector<EndFileCallback> m_endFileCallback;
-    std::vector<StreamPosChangeInFramesCallback> m_streamPosChangeInFramesCallback;
-    std::vector<StreamPosChangeCallback> m_streamPosChangeCallback;
-    std::vector<StreamPausedCallback> m_streamPausedCallback;
-    std::vector<StreamPlayingCallback> m_streamPlayingCallback;
-    std::vector<StreamStoppingCallback> m_streamStoppingCallback;
-    std::vector<StreamBufferingCallback> m_streamBufferingCallback;
-    std::vector<StreamEnoughBufferingCallback> m_streamEnoughBufferingCallback;
-    std::vector<IsReadyChangedCallback> m_isReadyChangedCallback;
+    std::shared_ptr<const std::vector<StartFileCallback>> m_startFileCallback;
+    std::shared_ptr<const std::vector<EndFileCallback>> m_endFileCallback;
+    std::shared_ptr<const std::vector<StreamPosChangeInFramesCallback>> m_streamPosChangeInFramesCallback;
+    std::shared_ptr<const std::vector<StreamPosChangeCallback>> m_streamPosChangeCallback;
+    std::shared_ptr<const std::vector<StreamPausedCallback>> m_streamPausedCallback;
+    std::shared_ptr<const std::vector<StreamPlayingCallback>> m_streamPlayingCallback;
+    std::shared_ptr<const std::vector<StreamStoppingCallback>> m_streamStoppingCallback;
+    std::shared_ptr<const std::vector<StreamBufferingCallback>> m_streamBufferingCallback;
+    std::shared_ptr<const std::vector<StreamEnoughBufferingCallback>> m_streamEnoughBufferingCallback;
+    std::shared_ptr<const std::vector<IsReadyChangedCallback>> m_isReadyChangedCallback;
     std::mutex m_startFileCallbackMutex,
                m_endFileCallbackMutex,
                m_streamPosChangeInFramesMutex,
@@ -224,16 +269,53 @@ private:
                m_isReadyChangedMutex;
 
     /*
-    List storing the callback call.
+    Queue storing the callback calls, the dispatcher thread
+    is the only consumer.
+    */
+    BoundedQueue<CallbackData> m_callbackQueue;
+
+    /*
+    Calls pushed while the callback queue is full,
+    no call is lost if the dispatcher is too late.
+    */
+    std::vector<CallbackData> m_overflowCalls;
+    std::mutex m_overflowCallsMutex;
+    std::atomic<bool> m_hasOverflowCalls;
+
+    // The dispatcher thread and its wake up.
+    std::thread m_dispatcherThread;
+    std::mutex m_dispatcherMutex;
+    std::condition_variable m_dispatcherCV;
+    std::atomic<bool> m_isDispatcherWaiting;
+    std::atomic<bool> m_isDispatcherStopping;
+    // The dispatcher is waiting without timeout, no position is pending.
+    std::atomic<bool> m_isDispatcherIdle;
+
+    /*
+    Latest stream position, overwritten by the stream callback
+    and read by the dispatcher thread. The position (lower
+    STREAM_POS_BITS bits) and its sample rate (upper bits) are
+    stored together to be read from the same file.
     */
-    std::list<CallbackData> m_callbackCall;
-    std::mutex m_callbackCallMutex;
+    std::atomic<uint64_t> m_streamPosAndSampleRate;
+    std::atomic<bool> m_isStreamPosPending;
+    std::atomic<int> m_streamPosChangeFrequency;
+    // Last positions sent to the callbacks, only used by the dispatcher thread.
+    size_t m_streamPosLastCallback;
+    size_t m_streamPosLastCallbackInSeconds;
 
     // This member variable store the last state of the isReady getter.
     bool m_isReadyLastStatus;
     // Allow this interface to get access to the isReady getter of AudioPlayer.
     std::function<bool()> m_isReadyGetter;
+    // The getter is removed before the player is destroyed.
+    std::mutex m_isReadyGetterMutex;
 };
+
+inline int CallbackInterface::streamPosChangeFrequency() const noexcept
+{
+    return m_streamPosChangeFrequency;
+}
 }
 
 #endif // SIMPLE_AUDIO_LIBRARY_STREAM_CALLBACK_H_
\ No newline at end of file
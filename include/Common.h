@@ -78,6 +78,125 @@ struct SAL_EXPORT_DLL EventData
     EventVariant data;
 };
 
+/*
+Buffering of the audio files, the durations are in milliseconds.
+- ringBufferMs: size of the ring buffer holding the decoded audio waiting to be played.
+- tmpBufferMs: size of the temporary buffer, the audio decoded at once.
+- lowWatermarkMs: the ring buffer is refilled (until full) when it hold less than this.
+- highWatermarkMs: after an underrun, the stream resume when the ring buffer hold this.
+- prefetchDepth: number of files opened and buffered at the same time, the current one included.
+- maxRingBufferBytes: upper limit of the ring buffer size in bytes, 0 for no limit.
+The ring buffer size is a power of two, it is never above this limit.
+This is useful for high sample rates and many channels.
+*/
+struct SAL_EXPORT_DLL BufferingPolicy
+{
+    size_t ringBufferMs = 5000;
+    size_t tmpBufferMs = 1000;
+    size_t lowWatermarkMs = 4000;
+    size_t highWatermarkMs = 2500;
+    int prefetchDepth = 2;
+    size_t maxRingBufferBytes = 0;
+};
+
+/*
+Statistics of the events send by the user.
+- received: number of events processed by the main loop.
+- coalesced: number of events dropped because a later event of
+the same kind was superseding them (seeks, play/pause).
+*/
+struct SAL_EXPORT_DLL EventStatistics
+{
+    size_t received = 0;
+    size_t coalesced = 0;
+};
+
+/*
+Where the audio stream is sent.
+- PORTAUDIO: play the audio on the default device of the backend audio.
+- NULL_SINK: discard the audio.
+- WAVE_FILE: write the audio into a 32 bits floating point WAVE file.
+*/
+enum class SAL_EXPORT_DLL AudioSinkType
+{
+    PORTAUDIO,
+    NULL_SINK,
+    WAVE_FILE,
+};
+
+/*
+Output of the audio stream.
+- type: the sink receiving the audio.
+- speed: speed of the clock of the null and WAVE file sinks, 1 is real time,
+2 twice faster and 0 as fast as possible. PortAudio follow the device clock.
+- filePath: path of the file written by the WAVE file sink. The file is
+rewritten each time a stream is created.
+- framesPerBuffer: number of frames asked to the stream callback at once
+by the null and WAVE file sinks, 0 for the default (512). PortAudio let
+the device choose.
+*/
+struct SAL_EXPORT_DLL AudioSinkConfig
+{
+    AudioSinkType type = AudioSinkType::PORTAUDIO;
+    double speed = 1.0;
+    std::string filePath;
+    size_t framesPerBuffer = 0;
+};
+
+/*
+Quality of the resampler, the number of taps of the filter
+(16, 32 and 64) and how close to the Nyquist frequency the
+cutoff is. Higher is slower.
+*/
+enum class SAL_EXPORT_DLL ResamplerQuality
+{
+    FAST,
+    MEDIUM,
+    BEST,
+};
+
+/*
+Shape of the gains of a crossfade.
+- LINEAR: the gains change linearly, the loudness dip in the middle.
+- EQUAL_POWER: the sum of the power of the two files stay the same.
+- S_CURVE: the gains change slowly at the start and at the end.
+*/
+enum class SAL_EXPORT_DLL CrossfadeCurve
+{
+    LINEAR,
+    EQUAL_POWER,
+    S_CURVE,
+};
+
+/*
+Crossfade between the end of a file and the start of the next one.
+- duration: duration of the crossfade in milliseconds, 0 to disable it.
+- curve: shape of the gains.
+*/
+struct SAL_EXPORT_DLL CrossfadeConfig
+{
+    int duration = 0;
+    CrossfadeCurve curve = CrossfadeCurve::EQUAL_POWER;
+};
+
+/*
+Format of the output stream.
+- sampleRate, numChannels: format of the output stream,
+0 to use the format of the first file of the stream.
+- isConverting: the files of another format are resampled and their channels
+remapped to the output format, the stream stay open and the files are played
+gaplessly. If false, the stream is recreated at the format of the file
+and the sample rate and the number of channels are not used.
+- resamplerQuality: quality of the resampler used when converting.
+*/
+struct SAL_EXPORT_DLL OutputFormat
+{
+    size_t sampleRate = 0;
+    int numChannels = 0;
+    bool isConverting = true;
+    ResamplerQuality resamplerQuality = ResamplerQuality::MEDIUM;
+};
+
 struct SAL_EXPORT_DLL FakeInt24
 {
     uint8_t c[3];
@@ -0,0 +1,131 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_DECODER_H_
+#define SIMPLE_AUDIO_LIBRARY_DECODER_H_
+
+#include "Common.h"
+#include <cstddef>
+#include <string>
+#include <memory>
+#include <vector>
+
+namespace SAL
+{
+class AbstractAudioFile;
+
+/*
+Synchronous decoder of audio files, independent of the AudioPlayer.
+
+The audio is decoded from the file directly into the buffer of the
+caller as 32 bits floating point numbers, the ring buffer and the
+temporary buffer of the player are not used and nothing is locked.
+A decoder must be used by one thread at a time, several decoders
+can be used in parallel.
+*/
+class SAL_EXPORT_DLL Decoder
+{
+    Decoder(const Decoder& other) = delete;
+    Decoder& operator=(const Decoder& other) = delete;
+public:
+    /*
+    Order of the samples in the output buffer.
+    - INTERLEAVED: the samples of each frame follow each other (L R L R).
+    - PLANAR: the samples of each channel follow each other (L L R R),
+    the plane of a channel is the size of the output in frames.
+    */
+    enum class Layout
+    {
+        INTERLEAVED,
+        PLANAR
+    };
+
+    Decoder();
+    /*
+    Open the file *filePath, check isOpen.
+    */
+    Decoder(const std::string& filePath);
+    ~Decoder();
+
+    /*
+    Open the file *filePath, the previous file is closed.
+    Return false if the file cannot be decoded.
+    */
+    bool open(const std::string& filePath);
+
+    /*
+    Close the file.
+    */
+    void close();
+
+    /*
+    Return true if a file is opened.
+    */
+    inline bool isOpen() const noexcept;
+
+    const std::string& filePath() const;
+    size_t sampleRate() const;
+    int numChannels() const;
+
+    /*
+    Size of the stream in frames.
+    */
+    size_t streamSize() const;
+
+    /*
+    Position of the next frame decoded.
+    */
+    size_t position() const;
+
+    /*
+    Move the position to *frame.
+    Return false if the position is not valid.
+    */
+    bool seek(size_t frame);
+
+    /*
+    Decode up to *frames frames from the position into *output, which
+    hold at least *frames times the number of channels samples.
+    Return the number of frames decoded, less than *frames at the end
+    of the stream. With the planar layout, the planes are *frames samples
+    apart even when less frames are decoded.
+    */
+    size_t read(float* output, size_t frames, Layout layout = Layout::INTERLEAVED);
+
+    /*
+    Decode up to *frames frames from the position into one
+    buffer per channel. Return the number of frames decoded.
+    */
+    size_t read(float* const* planes, size_t frames);
+
+    /*
+    Decode *frames frames starting at the frame *start into *output.
+    Return the number of frames decoded.
+    */
+    size_t readRange(size_t start, size_t frames, float* output, Layout layout = Layout::INTERLEAVED);
+
+    /*
+    Decode the stream from the position until the end into *output,
+    resized to the number of samples decoded. With the planar layout,
+    each plane is the number of frames decoded.
+    Return the number of frames decoded.
+    */
+    size_t readAll(std::vector<float>& output, Layout layout = Layout::INTERLEAVED);
+
+private:
+    /*
+    Decode into the planes through the scratch buffer.
+    *stride is the distance between two planes, 0 to use *planes.
+    */
+    size_t readPlanar(float* output, size_t stride, float* const* planes, size_t frames);
+
+    std::unique_ptr<AbstractAudioFile> m_file;
+
+    // Interleaved frames waiting to be split into planes.
+    std::vector<float> m_scratch;
+};
+
+inline bool Decoder::isOpen() const noexcept
+{
+    return m_file != nullptr;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_DECODER_H_
@@ -4,18 +4,47 @@
 #include "Common.h"
 #include <string>
 #include <variant>
-#include <list>
+#include <memory>
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <vector>
 
 namespace SAL
 {
 /*
 Class used to contain all the events send by
 the user. Play, Pause, Stop, Open, etc.
+
+The events are stored in an intrusive lock-free
+multi-producer/single-consumer queue: any thread can push
+an event, only the main loop retrieve them. The nodes
+are taken from a pool, new nodes are only allocated
+when the pool is empty.
+
+The WAIT_EVENT get a monotonically increasing ID, the main loop
+store the ID of the last WAIT_EVENT processed, this way
+waiting for an event to be processed is a comparison.
 */
 class SAL_EXPORT_DLL EventList
 {
     EventList(const EventList&) = delete;
+
+    /*
+    Node of the queue.
+    */
+    struct EventNode
+    {
+        std::atomic<EventNode*> next;
+        EventData data;
+        // Index of the node in the pool plus one, zero if the node is not from the pool.
+        uint32_t poolIndex;
+        // Index plus one of the next free node in the pool.
+        std::atomic<uint32_t> nextFree;
+    };
+
 public:
     EventList();
     ~EventList();
@@ -28,38 +57,132 @@ public:
     /*
     Retrieve an event (if available) and
     remove it from the queue.
+    Only the main loop can call this method.
     */
     EventData get();
 
+    /*
+    Move every available event at the end of *events
+    and return how many events were moved.
+    Only the main loop can call this method.
+    */
+    size_t drain(std::vector<EventData>& events);
+
     /*
     Return true if queue is not empty.
+    Only the main loop can call this method.
     */
     inline bool containEvents() const;
 
     /*
     Set a wait event and return the ID.
     */
-    int waitEvent();
+    size_t waitEvent();
+
+    /*
+    Return true if the WAIT_EVENT ID have been processed.
+    */
+    inline bool isWaitEventProcessed(size_t id) const;
 
     /*
-    Return true if WAIT_EVENT ID is in the queue.
+    Wait until the WAIT_EVENT ID is processed.
     */
-    bool isWaitEventIDPresent(int id) const;
+    void waitUntilProcessed(size_t id);
+
+    /*
+    Called by the main loop when a WAIT_EVENT is processed, the
+    threads waiting for this ID or a previous one are woken up.
+    */
+    void setWaitEventProcessed(size_t id);
+
+    /*
+    Wake up the thread waiting in the wait method.
+    Can be called from any thread.
+    */
+    void wakeUp();
+
+    /*
+    Wait until an event is pushed, wakeUp is called or the
+    *timeout is elapsed. The wait never exceed MAX_WAIT_TIME,
+    even if the *timeout is the maximum duration.
+    Only the main loop can call this method.
+    */
+    void wait(std::chrono::steady_clock::duration timeout);
 
 private:
-    std::list<EventData> m_queue;
-    mutable std::mutex m_queueMutex;
+    /*
+    Take a node from the pool or allocate
+    a new one if the pool is empty.
+    */
+    EventNode* acquireNode();
+
+    /*
+    Give back a node to the pool or delete it
+    if it was not from the pool.
+    */
+    void releaseNode(EventNode* node) noexcept;
+
+    /*
+    Link a node at the head of the queue.
+    */
+    void pushNode(EventNode* node) noexcept;
+
+    /*
+    Unlink the node at the tail of the queue,
+    or return nullptr if there is none.
+    */
+    EventNode* popNode() noexcept;
+
+    /*
+    Wake up the main loop if it is waiting.
+    */
+    void notifyIfWaiting();
+
+    /*
+    Producers are exchanging the head, the consumer
+    is moving the tail. The stub node is keeping the
+    queue never empty.
+    */
+    std::atomic<EventNode*> m_head;
+    EventNode* m_tail;
+    EventNode m_stub;
+
+    /*
+    Pool of nodes. The free list is a stack of indices,
+    the head store the index plus one in the lower 32 bits
+    and a counter in the upper 32 bits to avoid ABA.
+    */
+    std::unique_ptr<EventNode[]> m_pool;
+    std::atomic<uint64_t> m_freeHead;
+
+    // Waking up the main loop.
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitCV;
+    std::atomic<bool> m_isWaiting;
+    std::atomic<bool> m_isWakeUpRequested;
+
+    /*
+    WAIT_EVENT IDs. The IDs are given and pushed under the mutex,
+    this way they are in the queue in increasing order.
+    */
+    std::mutex m_waitEventMutex;
+    std::condition_variable m_waitEventCV;
+    size_t m_lastWaitEventID;
+    std::atomic<size_t> m_processedWaitEventID;
 };
 
-inline bool EventList::containEvents() const 
+inline bool EventList::containEvents() const
 {
-    std::scoped_lock lock(m_queueMutex);
-    return !m_queue.empty();
+    /*
+    The queue is empty when the consumer is on the stub node
+    and no producer have exchanged the head.
+    */
+    return m_tail != &m_stub || m_head.load() != &m_stub;
 }
-inline void EventList::push(EventType type, const EventVariant& data)
+
+inline bool EventList::isWaitEventProcessed(size_t id) const
 {
-    std::scoped_lock lock(m_queueMutex);
-    m_queue.push_back({type, data});
+    return m_processedWaitEventID.load(std::memory_order_acquire) >= id;
 }
 }
 
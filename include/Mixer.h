@@ -0,0 +1,192 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_MIXER_H_
+#define SIMPLE_AUDIO_LIBRARY_MIXER_H_
+
+#include "Common.h"
+#include "ActiveList.h"
+#include "AudioSink.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace SAL
+{
+class AbstractAudioFile;
+class PortAudioRAII;
+
+/*
+Play many files at the same time on one stream.
+
+Each file is a voice with its own gain and pan, every voice is
+converted to the format of the stream and the voices are summed
+in the stream callback with the vectorized mix kernels. The files
+are read from a refill thread, the stream callback never lock,
+allocate or read from the disk.
+
+The mixer is independent from the AudioPlayer, they can play
+at the same time on their own streams.
+*/
+class SAL_EXPORT_DLL Mixer
+{
+    Mixer(const Mixer& other) = delete;
+    Mixer& operator=(const Mixer& other) = delete;
+public:
+    Mixer();
+    ~Mixer();
+
+    /*
+    Open the stream of *numChannels at *sampleRate on the sink *sink.
+    The stream is not started.
+    */
+    bool open(size_t sampleRate, int numChannels, const AudioSinkConfig& sink = AudioSinkConfig());
+
+    /*
+    Stop the stream and remove every voice.
+    */
+    void close();
+
+    /*
+    Return true if the stream is open.
+    */
+    inline bool isOpen() const noexcept;
+
+    /*
+    Start or stop calling the stream callback.
+    */
+    bool start();
+    void stop();
+
+    /*
+    Open the file *filePath and add it to the mix.
+    - gain = linear gain of the voice.
+    - pan = balance of the voice, from -1 (left) to 1 (right).
+    - isLooping = the voice restart from the beginning at its end.
+    Return the ID of the voice, or -1 if the file cannot be played.
+    The voices not looping are removed once their last frame is played.
+    The loop is not gapless: a looping voice is silent from its end until
+    the refill thread read the beginning of the file again.
+    */
+    int addVoice(const std::string& filePath, float gain = 1.0f, float pan = 0.0f, bool isLooping = false);
+
+    /*
+    Remove the voice *id from the mix.
+    */
+    void removeVoice(int id);
+
+    /*
+    Change the gain or the pan of the voice *id.
+    The change is ramped over one block of the stream.
+    */
+    void setVoiceGain(int id, float gain);
+    void setVoicePan(int id, float pan);
+
+    /*
+    Return true if the voice *id is in the mix.
+    */
+    bool isVoicePlaying(int id);
+
+    /*
+    Number of voices in the mix.
+    */
+    size_t voiceCount();
+
+    /*
+    Gain applied to the sum of the voices.
+    */
+    inline void setMasterGain(float gain) noexcept;
+    inline float masterGain() const noexcept;
+
+    /*
+    Description of the last error.
+    */
+    std::string lastError();
+
+private:
+    struct Voice
+    {
+        int id;
+        std::unique_ptr<AbstractAudioFile> file;
+        std::atomic<float> gain;
+        std::atomic<float> pan;
+        bool isLooping;
+        // The refill thread is seeking the file, the voice is skipped.
+        std::atomic<bool> isSuspended;
+        // The stream callback played the last frame of the file.
+        std::atomic<bool> isDrained;
+        // Gain of each channel at the end of the last block, only used by the stream callback.
+        std::vector<float> appliedGains;
+    };
+
+    static AudioSink::StreamResult staticStreamCallback(
+        void* output,
+        unsigned long frames,
+        unsigned long& framesWritten,
+        void* data);
+    AudioSink::StreamResult streamCallback(float* output, unsigned long frames);
+
+    /*
+    Mix *frames frames (at most a block) of *voice into *output.
+    */
+    void mixVoice(Voice& voice, float* output, size_t frames);
+
+    /*
+    Read the files of the voices and remove the voices ended.
+    */
+    void refillLoop();
+
+    /*
+    Publish the voices to the stream callback.
+    Must be called with m_voicesMutex locked.
+    */
+    void publishVoices();
+
+    void setError(const std::string& error);
+
+    std::unique_ptr<PortAudioRAII> m_pa;
+    std::unique_ptr<AudioSink> m_sink;
+    std::atomic<bool> m_isOpen;
+    size_t m_sampleRate;
+    int m_numChannels;
+    std::atomic<float> m_masterGain;
+
+    // The refill thread keep a reference to the voices it is reading.
+    std::vector<std::shared_ptr<Voice>> m_voices;
+    std::mutex m_voicesMutex;
+    int m_nextVoiceID;
+    ActiveList<Voice*> m_activeVoices;
+
+    // Preallocated buffers of the stream callback: the frames of a voice and the gains.
+    std::vector<float> m_mixBuffer;
+    std::vector<float> m_gainBuffer;
+
+    std::thread m_refillThread;
+    std::atomic<bool> m_isRefillRunning;
+    std::atomic<bool> m_isRefillRequested;
+    std::mutex m_refillMutex;
+    std::condition_variable m_refillCV;
+
+    std::string m_lastError;
+    std::mutex m_errorMutex;
+};
+
+inline bool Mixer::isOpen() const noexcept
+{
+    return m_isOpen;
+}
+
+inline void Mixer::setMasterGain(float gain) noexcept
+{
+    m_masterGain = gain;
+}
+
+inline float Mixer::masterGain() const noexcept
+{
+    return m_masterGain;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_MIXER_H_
@@ -2,27 +2,35 @@
 #define SIMPLE_AUDIO_LIBRARY_PLAYER_H_
 
 #include "AbstractAudioFile.h"
+#include "ActiveList.h"
+#include "AudioSink.h"
 #include "Common.h"
 #include <vector>
 #include <string>
 #include <memory>
 #include <atomic>
 #include <mutex>
-
-struct PaStreamCallbackTimeInfo;
-typedef void PaStream;
+#include <functional>
+#include <chrono>
+#include <condition_variable>
 
 namespace SAL
 {
 class CallbackInterface;
+class ThreadPool;
 
 /*
-This class is doing all the job to communicate with PortAudio by
-creating the stream and sending data to PortAudio.
+This class is doing all the job to send the audio to the output
+sink (PortAudio by default) by creating the stream and sending data to it.
 
 It is managing the file queue, create new file stream and delete
 them when necessary.
 
+The stream callback run on the real-time thread of the sink, it never
+lock the queues. It read the files of the list published by the main
+loop each time the queue change, a file is deleted only once the
+callback stopped using it.
+
 The stream is always readed has 32 bits floating point numbers.
 */
 class SAL_EXPORT_DLL Player
@@ -109,16 +117,39 @@ public:
 
     /*
     Read audio data from file and push it
-    into the ring buffer and push file from
+    into the ring buffer (or schedule it on the
+    decode pool) and push file from
     m_queueFilePath to m_queueOpenedFile.
     */
     void update();
 
+    /*
+    Return how long the main loop can wait before calling update again.
+    It is zero while files are waiting to be opened or the ring buffers
+    are refilled by the main loop (or wait to be scheduled on the decode
+    pool) and the maximum duration when there is nothing to do.
+    */
+    std::chrono::steady_clock::duration timeBeforeNextUpdate();
+
     /*
     Set the pointer of the callback interface.
     */
     inline void setCallbackInterface(CallbackInterface* callbackInterface) noexcept;
 
+    /*
+    Set the function waking up the main loop. It is called
+    from the stream callback when a file need to be refilled
+    or when a file ended.
+    */
+    inline void setWakeUpCallback(std::function<void()> wakeUp);
+
+    /*
+    Set the thread pool reading the files, it can be shared
+    between several players. Without a pool, the files are
+    read by the main loop in update.
+    */
+    inline void setDecodePool(std::shared_ptr<ThreadPool> pool);
+
     /*
     Remove all in queue files but keep only the current one.
     This is useful when enabling or disabling shuffle playback.
@@ -128,6 +159,35 @@ public:
     inline BackendAudio getBackendAudio() const;
     void setBackendAudio(BackendAudio backend);
 
+    /*
+    Set the buffering policy of the files. The size of the
+    buffers is applied to the files not yet streamed, the
+    watermarks are applied to every opened file.
+    */
+    void setBufferingPolicy(const BufferingPolicy& policy);
+    BufferingPolicy bufferingPolicy() const;
+
+    /*
+    Set the output of the audio stream. It is used
+    the next time a stream is created.
+    */
+    void setAudioSink(const AudioSinkConfig& config);
+    AudioSinkConfig audioSink() const;
+
+    /*
+    Set the format of the output stream. It is used
+    the next time a stream is created.
+    */
+    void setOutputFormat(const OutputFormat& format);
+    OutputFormat outputFormat() const;
+
+    /*
+    Set the crossfade between the files of the queue,
+    used from the next buffer of the stream.
+    */
+    void setCrossfade(const CrossfadeConfig& config);
+    CrossfadeConfig crossfade() const;
+
     /*
     Convert host api enum to backend audio enum.
     */
@@ -144,6 +204,20 @@ private:
     */
     void pushFile();
 
+    /*
+    Publish the files of m_queueOpenedFile to the stream callback.
+    When the method return, the callback no longer use the previous
+    list and the files removed from the queue can be deleted.
+    */
+    void publishActiveFiles();
+
+    /*
+    Mark the files of m_refillFiles removed from m_queueOpenedFile,
+    the decode pool stop reading them.
+    Must be called with m_queueOpenedFileMutex locked.
+    */
+    void markRemovedRefillFiles();
+
     /*
     Check what type is the file and opening it.
     */
@@ -166,12 +240,13 @@ private:
 
     /*
     Check if the audio file (file) have the info than the
-    currently played file.
+    currently played file. When the files are converted to
+    the output format, any valid file is accepted.
     */
     bool checkStreamInfo(const AbstractAudioFile* const  file) const;
 
     /*
-    Create the PaStream.
+    Create the output sink and open the stream.
     */
     bool createStream();
 
@@ -191,23 +266,41 @@ private:
     void clearUnneededStream();
 
     /*
-    Recreate the PortAudio stream for new files
+    Recreate the stream for new files
     with different stream info.
     */
     void recreateStream();
 
     /*
-    Close the PortAudio stream when asked.
+    Close the stream when asked.
     */
     void closeStreamWhenNeeded();
 
     /*
     Update audio stream buffer.
     Read from the audio files and push the data
-    into the ring buffer.
+    into the ring buffer, or schedule the refill
+    of the files on the decode pool.
     */
     void updateStreamBuffer();
 
+    /*
+    Time in milliseconds before the file *index of m_queueOpenedFile is
+    read. A file is read once the files before it are within the low
+    watermark (plus the crossfade) of their end, the buffers of a file
+    waiting in the queue are not allocated until then.
+    Must be called with m_queueOpenedFileMutex locked.
+    */
+    size_t timeBeforeReading(size_t index) const;
+
+    /*
+    Task of the decode pool: read a temporary buffer of the file the
+    less buffered of m_refillFiles, then submit the task again until
+    the ring buffer of this file is full. There is one task per file
+    of m_refillFiles, the queues are not locked.
+    */
+    void refillFiles();
+
     /*
     Set m_isPlaying to false if there is no audio file to stream.
     */
@@ -232,26 +325,40 @@ private:
 
     /*
     Static C callback use to make a bridge between
-    PortAudio and this class.
+    the output sink and this class.
     */
-    static int staticPortAudioStreamCallback(
-        const void* inputBuffer,
+    static AudioSink::StreamResult staticStreamCallback(
         void* outputBuffer,
         unsigned long framesPerBuffer,
-        const PaStreamCallbackTimeInfo* timeInfo,
-        unsigned long flags,
+        unsigned long& framesWritten,
         void* data);
-    static void staticPortAudioEndStream(void* data);
+    static void staticEndStream(void* data);
     
     /*
     Stream callback used to collect audio stream
     from the audio file interface and sending it to
-    PortAudio.
+    the output sink. *framesWritten is set to the
+    number of frames of audio, the rest is silence.
+    It only read the files of m_activeFiles.
     */
-    int streamCallback(
-        const void* inputBuffer,
+    AudioSink::StreamResult streamCallback(
         void* outputBuffer,
-        unsigned long framesPerBuffer);
+        unsigned long framesPerBuffer,
+        unsigned long& framesWritten);
+
+    /*
+    Write *framesPerBuffer frames into *output: the end of *current
+    mixed with the start of *next, the crossfade last *crossfadeFrames.
+    *isBuffering is set if *current need buffering.
+    Return the number of frames of audio.
+    */
+    size_t crossfadeFiles(
+        AbstractAudioFile* current,
+        AbstractAudioFile* next,
+        float* output,
+        size_t framesPerBuffer,
+        size_t crossfadeFrames,
+        bool& isBuffering);
 
     /*
     When the stream reach end, this member function
@@ -270,15 +377,9 @@ private:
     void endStreamingFile(const std::string& filePath);
 
     /*
-    Call the stream position change in frames.
+    Publish the stream position to the callback interface.
     */
-    void streamPosChangeInFrames(size_t streamPos);
-
-    /*
-    Call stream position (in seconds) callback if the position (in seconds)
-    changed since the last callback.
-    */
-    void streamPosChangeCallback();
+    void streamPosChange(size_t streamPos, size_t sampleRate);
 
     /*
     Called when the stream is pausing.
@@ -305,6 +406,11 @@ private:
     */
     void streamEnoughBufferingCallback();
 
+    /*
+    Wake up the main loop to update the stream.
+    */
+    inline void wakeUpMainLoop();
+
     /*
     Retrieve the list of backend API available.
     */
@@ -323,16 +429,25 @@ private:
 
     /*
     Current streamed file and the next file that have the same
-    channels and samplerate.
+    channels and samplerate. The files refilled on the decode
+    pool are kept alive until their task is done.
     */
-    std::vector<std::unique_ptr<AbstractAudioFile>> m_queueOpenedFile;
+    std::vector<std::shared_ptr<AbstractAudioFile>> m_queueOpenedFile;
     mutable std::mutex m_queueOpenedFileMutex;
 
-    // PortAudio stream interface.
-    static int _destroyStream(PaStream* stream);
-    std::unique_ptr<PaStream, decltype(&_destroyStream)> m_paStream;
+    // Files of m_queueOpenedFile read by the stream callback.
+    ActiveList<AbstractAudioFile*> m_activeFiles;
+    // The callback output silence while the main loop is seeking.
+    std::atomic<bool> m_isStreamSuspended;
+
+    // Output sink of the stream.
+    std::unique_ptr<AudioSink> m_sink;
     std::atomic<BackendAudio> m_backendAudio;
-    std::mutex m_paStreamMutex;
+    std::mutex m_sinkMutex;
+    // Output configuration, applied when a stream is created.
+    AudioSinkConfig m_sinkConfig;
+    OutputFormat m_outputFormat;
+    mutable std::mutex m_sinkConfigMutex;
     std::atomic<bool> m_isClosingStreamTheStream; // When a stream stop, it ask to close the stream.
 
     // If the stream is playing or not.
@@ -343,6 +458,9 @@ private:
     // Maximum of same stream in the m_queueOpenedFile queue.
     std::atomic<int> m_maxInStreamQueue;
 
+    // Buffering policy given to the opened files, protected by m_queueOpenedFileMutex.
+    BufferingPolicy m_bufferingPolicy;
+
     /*
     Stream info.
     */
@@ -350,16 +468,42 @@ private:
     std::atomic<size_t> m_sampleRate;
     std::atomic<int> m_bytesPerSample;
     std::atomic<SampleType> m_sampleType;
+    // Are the files of another format converted to the stream format.
+    std::atomic<bool> m_isConvertingStream;
+    std::atomic<ResamplerQuality> m_resamplerQuality;
+
+    // Crossfade between the files, the duration is in milliseconds.
+    std::atomic<int> m_crossfadeDuration;
+    std::atomic<CrossfadeCurve> m_crossfadeCurve;
+    // Next file and gains of a block of the crossfade, allocated with the stream.
+    std::vector<float> m_crossfadeBuffer;
 
     /*
     Pointer to the callback interface.
     */
     CallbackInterface* m_callbackInterface;
 
+    // Wake up the main loop of the AudioPlayer class.
+    std::function<void()> m_wakeUp;
+
     /*
-    Last position in seconds registered by stream pos callback
+    File refilled on the decode pool, isReading is set while a task read it
+    and isRemoved once the file is removed from m_queueOpenedFile.
     */
-    size_t m_streamPosLastCallback;
+    struct RefillFile
+    {
+        std::shared_ptr<AbstractAudioFile> file;
+        bool isReading;
+        bool isRemoved;
+    };
+
+    // Decode pool, the files refilled on it and the number of tasks submitted.
+    std::shared_ptr<ThreadPool> m_decodePool;
+    std::vector<RefillFile> m_refillFiles;
+    size_t m_refillTasks;
+    bool m_isRefillStopping;
+    std::mutex m_refillTaskMutex;
+    std::condition_variable m_refillTaskCV;
 
     // Prevent infinity loop trying to open a file if the file have a different stream information.
     bool m_doNotCheckFile;
@@ -381,10 +525,16 @@ inline void Player::seek(size_t pos, bool inSeconds) noexcept
     std::scoped_lock lock(m_queueOpenedFileMutex);
     if (!m_queueOpenedFile.empty())
     {
+        // The ring buffer is cleared, the callback must not read it.
+        m_isStreamSuspended = true;
+        m_activeFiles.synchronize();
+
         if (inSeconds)
             m_queueOpenedFile.at(0)->seekInSeconds(pos);
         else
             m_queueOpenedFile.at(0)->seek(pos);
+
+        m_isStreamSuspended = false;
     }
 }
 
@@ -396,6 +546,31 @@ inline void Player::setCallbackInterface(CallbackInterface* callbackInterface) n
     m_callbackInterface = callbackInterface;
 }
 
+/*
+Set the function waking up the main loop.
+*/
+inline void Player::setWakeUpCallback(std::function<void()> wakeUp)
+{
+    m_wakeUp = wakeUp;
+}
+
+/*
+Set the thread pool reading the files.
+*/
+inline void Player::setDecodePool(std::shared_ptr<ThreadPool> pool)
+{
+    m_decodePool = pool;
+}
+
+/*
+Wake up the main loop to update the stream.
+*/
+inline void Player::wakeUpMainLoop()
+{
+    if (m_wakeUp)
+        m_wakeUp();
+}
+
 /*
 Return stream size of the raw stream (not necessarily in 32 bits float).
 timeType: choose between frames or seconds base time.
@@ -415,7 +590,7 @@ inline size_t Player::_streamSize(TimeType timeType) const noexcept
 {
     if (!m_queueOpenedFile.empty())
     {
-        const std::unique_ptr<AbstractAudioFile>& audioFile =
+        const std::shared_ptr<AbstractAudioFile>& audioFile =
             m_queueOpenedFile.at(0);
         if (timeType == TimeType::FRAMES)
             return m_queueOpenedFile.at(0)->streamSize();
@@ -445,7 +620,7 @@ inline size_t Player::_streamPos(TimeType timeType) const noexcept
 {
     if (!m_queueOpenedFile.empty())
     {
-        const std::unique_ptr<AbstractAudioFile>& audioFile =
+        const std::shared_ptr<AbstractAudioFile>& audioFile =
             m_queueOpenedFile.at(0);
         if (timeType == TimeType::FRAMES)
             return m_queueOpenedFile.at(0)->streamPos();
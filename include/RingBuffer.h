@@ -8,8 +8,43 @@
 
 namespace SAL
 {
+/*
+Up to two contiguous regions of the storage of a RingBuffer.
+The second region is only used when the data wrap around
+the end of the storage.
+*/
+struct SAL_EXPORT_DLL RingBufferSpans
+{
+    char* first;
+    size_t firstSize;
+    char* second;
+    size_t secondSize;
+
+    /*
+    Return the total size in bytes of the regions.
+    */
+    inline size_t size() const noexcept { return firstSize + secondSize; }
+};
+
 /*
 Circular buffer used to stream audio.
+
+The size of the buffer is rounded up to a power of two so the
+positions are wrapped with a mask. On Linux, when the option
+USE_MIRRORED_RING_BUFFER is on, the storage is mapped twice back
+to back in virtual memory, this way any readable or writable region
+is contiguous. If the mapping fail, a regular allocation is used.
+
+The buffer is a wait-free single-producer/single-consumer
+queue: one thread is writing (the decoding thread) and one
+thread is reading (the PortAudio stream callback).
+The head position is only moved by the producer and the tail
+position only by the consumer, so read and write never block.
+
+resizeBuffer and clear are modifying both positions and the
+storage, they are using a quiesce protocol: new read and write
+calls are rejected (they return 0) and the call wait until the
+read or write in progress are done.
 */
 class SAL_EXPORT_DLL RingBuffer
 {
@@ -22,59 +57,187 @@ public:
     /*
     Read *size data inside the circular buffer
     into the *buffer. Return how many bytes readed.
+    Only one thread at a time can read.
     */
     size_t read(char* buffer, size_t size);
 
     /*
     Write *size of *buffer into the circular buffer.
     Return how many bytes writed.
+    Only one thread at a time can write.
     */
     size_t write(const char* buffer, size_t size);
 
     /*
-    Resize the circular buffer to *bufferSize.
+    Reserve up to *size bytes of writable space in the circular buffer.
+    The data can be writen directly inside the returned regions and
+    is published to the reader with commitWrite.
+    Until commitWrite is called, the buffer cannot be cleared or resized.
+    */
+    RingBufferSpans reserveWrite(size_t size);
+
+    /*
+    Publish *size bytes writen into the regions returned by reserveWrite
+    and end the reservation. *size cannot be more than the reserved size.
+    */
+    void commitWrite(size_t size);
+
+    /*
+    Return up to *size bytes of readable data in the circular buffer
+    without removing it. The data is released with consumeRead.
+    Until consumeRead is called, the buffer cannot be cleared or resized.
+    */
+    RingBufferSpans peekRead(size_t size);
+
+    /*
+    Remove *size bytes of the data returned by peekRead
+    and end the reservation. *size cannot be more than the peeked size.
+    */
+    void consumeRead(size_t size);
+
+    /*
+    Resize the circular buffer to *bufferSize (rounded up to a power of two).
     Remove any data inside the circular buffer.
-    This function is not thread safe, so be carefull when
-    calling it.
+    Wait until the pending read and write are done.
     */
     void resizeBuffer(size_t bufferSize);
 
+    /*
+    Return the size of the storage allocated for *bufferSize bytes,
+    *bufferSize rounded up to a power of two.
+    */
+    static size_t storageSize(size_t bufferSize) noexcept;
+
     inline size_t size() const noexcept;
 
+    /*
+    Return true if the storage is mapped twice in memory
+    (every region is contiguous).
+    */
+    inline bool isMirrored() const noexcept;
+
     /*
     Return the size of data readable in the buffer.
     */
     inline size_t readable() const noexcept;
 
     /*
-    Clearing the ring buffer of all data.
+    Return the size of data writable in the buffer.
+    */
+    inline size_t writable() const noexcept;
+
+    /*
+    Clearing the ring buffer of all data, the storage is not zeroed.
+    Wait until the pending read and write are done.
     */
     void clear();
 
 private:
+    /*
+    Register a read or write in progress.
+    Return false if the buffer is quiescing,
+    the caller must leave without touching the buffer.
+    */
+    bool enter() noexcept;
+
+    /*
+    Unregister a read or write in progress.
+    */
+    void leave() noexcept;
+
+    /*
+    Reject new read and write and wait until
+    the ones in progress are done.
+    */
+    void quiesce() noexcept;
+
+    /*
+    Allow read and write again.
+    */
+    void resume() noexcept;
+
+    /*
+    Allocate the storage of the buffer with a size of *bufferSize
+    rounded up to a power of two. The mirrored mapping is tried first.
+    */
+    void allocateStorage(size_t bufferSize);
+
+    /*
+    Release the storage of the buffer.
+    */
+    void releaseStorage() noexcept;
+
+    /*
+    Try to map the same memory twice back to back.
+    Return false if the mapping is not available.
+    */
+    bool allocateMirroredStorage(size_t bufferSize) noexcept;
+
+    /*
+    Return the regions of the storage starting at
+    the position *pos with a size of *size bytes.
+    */
+    RingBufferSpans spansAt(size_t pos, size_t size) const noexcept;
+
     char* m_data;
     std::atomic<size_t> m_size;
+    // Size minus one, used to wrap the positions.
+    size_t m_mask;
+    // Is the storage mapped twice in memory.
+    bool m_isMirrored;
+
+    /*
+    Monotonic positions in bytes, the index in the buffer
+    is the position masked with the size of the buffer.
+    The tail is only moved by the reader and the head
+    only by the writer.
+    */
     std::atomic<size_t> m_tailPos;
     std::atomic<size_t> m_headPos;
-    std::atomic<size_t> m_writeAvailable;
+
+    // Quiesce protocol.
+    std::atomic<bool> m_isQuiescing;
+    std::atomic<int> m_activeUsers;
 
     /*
-    Preventing the streamCallback and the update
-    method to read, clear and resize the ring buffer 
-    at the same time.
+    Size of the pending reservations. They are only
+    accessed by the writer and the reader respectively.
     */
-    std::mutex m_readMutex;
+    size_t m_writeReserved;
+    bool m_isWriteReserved;
+    size_t m_readReserved;
+    bool m_isReadReserved;
+
+    /*
+    Preventing clear and resizeBuffer to be
+    called at the same time.
+    */
+    std::mutex m_quiesceMutex;
 };
 
 inline size_t RingBuffer::readable() const noexcept
 {
-    return m_size - m_writeAvailable;
+    // The tail is loaded first, this way it cannot be ahead of the head.
+    size_t tailPos = m_tailPos.load(std::memory_order_acquire);
+    size_t headPos = m_headPos.load(std::memory_order_acquire);
+    size_t readableSize = headPos - tailPos;
+    return readableSize < m_size ? readableSize : static_cast<size_t>(m_size);
+}
+
+inline size_t RingBuffer::writable() const noexcept
+{
+    return m_size - readable();
 }
 
 inline size_t RingBuffer::size() const noexcept
 {
     return m_size;
 }
+
+inline bool RingBuffer::isMirrored() const noexcept
+{
+    return m_isMirrored;
+}
 }
 
 #endif // SIMPLE_AUDIO_LIBRARY_RINGBUFFER_H_
\ No newline at end of file
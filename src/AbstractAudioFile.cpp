@@ -1,8 +1,9 @@
 #include "AbstractAudioFile.h"
 #include "DebugLog.h"
+#include "SampleConverter.h"
+#include "StreamConverter.h"
 #include <cstring>
 #include <limits>
-#include <vector>
 
 // Define CLASS_NAME to have the name of the class.
 const std::string CLASS_NAME = "AbstractAudioFile";
@@ -18,6 +19,19 @@ AbstractAudioFile::AbstractAudioFile(const std::string& filePath) :
     m_tmpSizeDataWritten(0),
     m_tmpSize(0),
     m_tmpMinimumSize(0),
+    m_tmpPlannedSize(0),
+    m_ringBufferPlannedSize(0),
+    m_extraFrames(0),
+    m_lowWatermarkSize(0),
+    m_highWatermarkSize(0),
+    m_isRefilling(true),
+    m_isLowWatermarkArmed(true),
+    m_outputSampleRate(0),
+    m_isDecoding(false),
+    m_decodeOutput(nullptr),
+    m_decodeSamples(0),
+    m_decodeWritten(0),
+    m_decodeOverflowPos(0),
 
     // Audio file info
     m_sampleRate(0),
@@ -41,6 +55,7 @@ AbstractAudioFile::AbstractAudioFile(const std::string& filePath) :
 
     // Is the stream has reached the end.
     m_isEnded(false),
+    m_isOutputPending(false),
 
     // Streaming pos from audio file.
     m_readPos(0)
@@ -55,6 +70,30 @@ AbstractAudioFile::~AbstractAudioFile()
     delete[] m_tmpBuffer;
 }
 
+bool AbstractAudioFile::isRefilling()
+{
+    std::scoped_lock lock(m_readFromFileMutex);
+    return m_isOpen && !m_endFile && m_isRefilling;
+}
+
+bool AbstractAudioFile::isRefillNeeded()
+{
+    std::scoped_lock lock(m_readFromFileMutex);
+    return m_isOpen && !m_endFile &&
+        (m_isRefilling || m_ringBuffer.readable() < m_lowWatermarkSize);
+}
+
+bool AbstractAudioFile::isLowWatermarkCrossed() noexcept
+{
+    // Rearmed each time the ring buffer is above the low watermark.
+    if (m_ringBuffer.readable() >= m_lowWatermarkSize)
+    {
+        m_isLowWatermarkArmed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+    return m_isLowWatermarkArmed.exchange(false, std::memory_order_relaxed);
+}
+
 void AbstractAudioFile::readFromFile()
 {
     /*
@@ -65,6 +104,20 @@ void AbstractAudioFile::readFromFile()
     if (!m_isOpen || m_endFile)
         return;
 
+    // The buffers are only allocated when the file is streamed.
+    allocateBuffers();
+
+    /*
+    The ring buffer is refilled when it goes under the low watermark,
+    until it is full (the temporary buffer cannot be flushed anymore).
+    */
+    if (m_tmpTailPos != m_tmpSizeDataWritten && m_ringBuffer.writable() == 0)
+        m_isRefilling = false;
+    else if (m_ringBuffer.readable() < m_lowWatermarkSize)
+        m_isRefilling = true;
+    if (!m_isRefilling)
+        return;
+
     if (m_tmpTailPos == m_tmpSizeDataWritten)
     {
         m_tmpTailPos = 0;
@@ -98,7 +151,7 @@ void AbstractAudioFile::resizeTmpBuffer(size_t size)
         else
             bufferSize = m_tmpSize;
         memcpy(tmpBuffer, m_tmpBuffer, bufferSize);
-        delete m_tmpBuffer;
+        delete[] m_tmpBuffer;
     }
 
     // Update tmp buffer information.
@@ -114,157 +167,202 @@ void AbstractAudioFile::resizeTmpBuffer(size_t size)
     SAL_DEBUG_READ_FILE("Resizing tmpBuffer done")
 }
 
-// Template to convert data from an integer to a float number.
-template<typename T>
-std::vector<float> intArrayToFloatArray(T* iBuffer, size_t samples)
+void AbstractAudioFile::convertToFloat(const char* buffer, float* output, size_t samples) const
 {
-    std::vector<float> fBuffer(samples);
+    if (samples == 0)
+        return;
 
-    uint32_t max = 0;
-    uint32_t min = 0;
+    /*
+    Signed integers are converted in the range [-1,1], unsigned 8 bit integers are divided
+    by 127.5 and subtracted by 1 and floating point numbers are copied.
+    The kernel of the fastest instructions set available is used.
+    */
+    SampleConverter::convert(
+        SampleConverter::format(m_sampleType, bytesPerSample()),
+        buffer, output, samples);
+}
 
-    // Get max and min value based on the type.
-    if (sizeof(T) == 1)
-    {
-        max = 0x7F; // 127
-        min = 0x80; // 128 : the max negative number is always one number higher.
-    }
-    else if (sizeof(T) == 2)
-    {
-        max = 0x7FFF;
-        min = 0x8000;
-    }
-    else if (sizeof(T) == 4)
-    {
-        max = 0x7FFFFFFF;
-        min = 0x80000000;
-    }
+void AbstractAudioFile::insertDataInfoTmpBuffer(const char* buffer, size_t size)
+{
+    if (size == 0 || bytesPerSample() == 0)
+        return;
 
-    for (int i = 0; i < samples; i++)
+    size_t samples = size / bytesPerSample();
+
+    // The data goes to the output of decode.
+    if (m_isDecoding)
     {
-        // Convert int to float and in the range [-1,1].
-        float number = (float)iBuffer[i];
-        fBuffer[i] = number / (number < 0 ? (float)min : (float)max);
+        insertDecodedData(buffer, samples);
+        return;
     }
 
-    return fBuffer;
-}
-
-// Convert 24 bits integers to floating point numbers.
-// Since no 24 bits integer exist in c++, this fonction convert manually the number to a 32 bit integers.
-template<>
-std::vector<float> intArrayToFloatArray(FakeInt24* iBuffer, size_t samples)
-{
-    // Min and max value.
-    uint32_t max = 0x7FFFFF;
-    uint32_t min = 0x800000;
-
-    std::vector<float> fBuffer(samples);
+    SAL_DEBUG_READ_FILE("Inserting data into the temporary buffer")
+    size_t samplesConverted = 0;
 
-    for (size_t i = 0; i < samples; i++)
+    /*
+    If no data is waiting in the tmp buffer, the data is converted to 32 bits
+    floating point numbers directly inside the ring buffer storage.
+    */
+    if (m_tmpTailPos == m_tmpSizeDataWritten)
     {
-        FakeInt24 number24 = iBuffer[i];
-        int number32 = 0;
+        RingBufferSpans spans = m_ringBuffer.reserveWrite(samples * sizeof(float));
+
+        size_t firstSamples = spans.firstSize / sizeof(float);
+        convertToFloat(buffer, (float*)spans.first, firstSamples);
+        samplesConverted = firstSamples;
 
-        // Check if the number have the negative sign.
-        if (number24.c[2] & 0x80)
+        // The second region is only contiguous with the first one on a whole sample.
+        if (firstSamples * sizeof(float) == spans.firstSize)
         {
-            number32 = 0xFFFFFFFF; // When negative all the bits are flipped. 0xFFFFFFFF is equal to -1.
+            size_t secondSamples = spans.secondSize / sizeof(float);
+            convertToFloat(buffer + firstSamples * bytesPerSample(), (float*)spans.second, secondSamples);
+            samplesConverted += secondSamples;
         }
 
-        // Copy number24 to number32.
-        FakeInt24* n32 = reinterpret_cast<FakeInt24*>(&number32);
-        n32->c[0] = number24.c[0];
-        n32->c[1] = number24.c[1];
-        n32->c[2] = number24.c[2]; // No need to worry about the 8 bit because if it's negative, it will be equal to 1.
-
-        // Convert number32 to float and in the range [-1,1]
-        float fNumber = (float)number32;
-        fBuffer[i] = fNumber / (fNumber < 0 ? (float)min : (float)max);
+        m_ringBuffer.commitWrite(samplesConverted * sizeof(float));
     }
 
-    return fBuffer;
+    // The remaining data is converted into the tmp buffer, waiting to be flushed.
+    size_t sizeDataInBytes = (samples - samplesConverted) * sizeof(float);
+    if (sizeDataInBytes == 0)
+        return;
+
+    // The buffer is allocated once in allocateBuffers, it only grow if the decoder overshoot it.
+    if (m_tmpWritePos + sizeDataInBytes > m_tmpSize)
+        resizeTmpBuffer(m_tmpWritePos + sizeDataInBytes);
+    convertToFloat(
+        buffer + samplesConverted * bytesPerSample(),
+        (float*)(m_tmpBuffer+m_tmpWritePos),
+        samples - samplesConverted);
+
+    m_tmpWritePos += sizeDataInBytes;
+    m_tmpSizeDataWritten += sizeDataInBytes;
+
+    SAL_DEBUG_READ_FILE("Inserting data into the temporary buffer done")
 }
 
-void AbstractAudioFile::insertDataInfoTmpBuffer(char* buffer, size_t size)
+void AbstractAudioFile::insertDecodedData(const char* buffer, size_t samples)
 {
-    if (size == 0)
-        return;
+    size_t outputSamples = m_decodeSamples - m_decodeWritten;
+    if (outputSamples > samples)
+        outputSamples = samples;
+    convertToFloat(buffer, m_decodeOutput + m_decodeWritten, outputSamples);
+    m_decodeWritten += outputSamples;
+
+    // The samples past the output are converted into the overflow buffer.
+    if (outputSamples < samples)
+    {
+        size_t overflowSize = m_decodeOverflow.size();
+        m_decodeOverflow.resize(overflowSize + samples - outputSamples);
+        convertToFloat(
+            buffer + outputSamples * bytesPerSample(),
+            m_decodeOverflow.data() + overflowSize,
+            samples - outputSamples);
+    }
+}
 
-    SAL_DEBUG_READ_FILE("Inserting data into the temporary buffer")
+size_t AbstractAudioFile::decode(float* output, size_t frames)
+{
+    if (!m_isOpen || !output || frames == 0 || numChannels() <= 0 || m_isEnded)
+        return 0;
 
-    std::vector<float> data;
+    SAL_DEBUG_READ_FILE("Decoding " + std::to_string(frames) + " frames")
 
-    // Convert the input stream to 32 bits floating point numbers and copy it into the tmp buffer.
-    // Signed integers to floating point numbers.
-    if (m_sampleType == SampleType::INT)
+    m_decodeOutput = output;
+    m_decodeSamples = frames * numChannels();
+    m_decodeWritten = 0;
+
+    // Start with the samples decoded past the previous output.
+    size_t overflowSamples = m_decodeOverflow.size() - m_decodeOverflowPos;
+    if (overflowSamples > 0)
     {
-        if (bytesPerSample() == 1)
-        {
-            data = intArrayToFloatArray<char>(buffer, size);
-        }
-        else if (bytesPerSample() == 2)
+        if (overflowSamples > m_decodeSamples)
+            overflowSamples = m_decodeSamples;
+        memcpy(output, m_decodeOverflow.data() + m_decodeOverflowPos, overflowSamples * sizeof(float));
+        m_decodeOverflowPos += overflowSamples;
+        m_decodeWritten = overflowSamples;
+        // The capacity is kept, the overflow buffer is not reallocated.
+        if (m_decodeOverflowPos == m_decodeOverflow.size())
         {
-            data = intArrayToFloatArray<short>((short*)buffer, size/bytesPerSample());
+            m_decodeOverflow.clear();
+            m_decodeOverflowPos = 0;
         }
-        else if (bytesPerSample() == 3)
-        {
-            data = intArrayToFloatArray<FakeInt24>((FakeInt24*)buffer, size/bytesPerSample());
-        }
-        else if (bytesPerSample() == 4)
-        {
-            data = intArrayToFloatArray<int>((int*)buffer, size/bytesPerSample());
-        }
-    }
-    // For float, just copy the data.
-    else if (m_sampleType == SampleType::FLOAT)
-    {
-        data.resize(size/bytesPerSample());
-        memcpy(data.data(), buffer, size);
     }
-    // Unsigned 8 bit integer to floating point number.
-    else
+
+    m_isDecoding = true;
+    while (m_decodeWritten < m_decodeSamples && !m_endFile)
     {
-        /*
-        To convert a unsigned integer into a floating point number, the number is divided by
-        half the max value of the integer (127.5 here) to get a range between [0,2] and then subtracted by 1
-        to get a range between [-1,1].
-        */
-        float max = 127.5f;
-        data.resize(size);
-        uint8_t* b = (uint8_t*)buffer;
-
-        for (size_t i = 0; i < size; i++)
-        {
-            data[i] = (float)b[i] / max;
-            data[i] -= 1.0f;
-        }
+        size_t previousReadPos = m_readPos;
+        readDataFromFile();
+        // The decoder failed without ending the file.
+        if (m_readPos == previousReadPos)
+            break;
     }
+    m_isDecoding = false;
+    m_decodeOutput = nullptr;
 
-    // Copy data to the tmp buffer.
-    size_t sizeDataInBytes = data.size() * sizeof(float);
-    if (m_tmpWritePos + sizeDataInBytes > m_tmpSize)
-        resizeTmpBuffer(m_tmpWritePos + sizeDataInBytes);
-    memcpy(m_tmpBuffer+m_tmpWritePos, data.data(), data.size() * sizeof(float));
+    size_t framesDecoded = m_decodeWritten / numChannels();
+    m_streamPos += framesDecoded * bytesPerFrame();
+    updateStreamPosInfo();
+    if (m_streamPos >= m_sizeStream || (framesDecoded < frames && m_decodeOverflow.empty()))
+        m_isEnded = true;
 
-    m_tmpWritePos += sizeDataInBytes;
-    m_tmpSizeDataWritten += sizeDataInBytes;
+    SAL_DEBUG_READ_FILE("Decoding done")
 
-    SAL_DEBUG_READ_FILE("Inserting data into the temporary buffer done")
+    return framesDecoded;
+}
+
+bool AbstractAudioFile::decodeSeek(size_t pos)
+{
+    if (!m_isOpen || pos >= streamSize())
+        return false;
+
+    SAL_DEBUG_EVENTS("Decoding from position " + std::to_string(pos))
+
+    // The data decoded while seeking (FLAC) goes into the overflow buffer.
+    m_decodeOverflow.clear();
+    m_decodeOverflowPos = 0;
+    m_decodeOutput = nullptr;
+    m_decodeSamples = 0;
+    m_decodeWritten = 0;
+    m_isDecoding = true;
+    bool isSeeked = updateReadingPos(pos);
+    m_isDecoding = false;
+    if (!isSeeked)
+        return false;
+
+    m_streamPos = pos * bytesPerFrame();
+    updateStreamPosInfo();
+    m_readPos = m_streamPos + m_decodeOverflow.size() * bytesPerSample();
+    m_endFile = m_readPos >= streamSizeInBytes();
+    m_isEnded = false;
+    return true;
 }
 
 void AbstractAudioFile::flush()
 {
     std::scoped_lock lock(m_readFromFileMutex);
-    if (m_tmpTailPos == m_tmpSizeDataWritten || !m_tmpBuffer)
+
+    // The stream reached the end, the ring buffer is no longer needed.
+    if (m_isEnded && m_ringBuffer.size() > 0)
+        m_ringBuffer.resizeBuffer(0);
+
+    if (!m_tmpBuffer)
         return;
 
-    SAL_DEBUG_READ_FILE("Flushing data from the temporary buffer to the ring buffer")
-    
-    size_t nbWrited = m_ringBuffer.write(m_tmpBuffer+m_tmpTailPos, m_tmpSizeDataWritten-m_tmpTailPos);
-    m_tmpTailPos += nbWrited;
+    if (m_tmpTailPos != m_tmpSizeDataWritten)
+    {
+        SAL_DEBUG_READ_FILE("Flushing data from the temporary buffer to the ring buffer")
+
+        size_t nbWrited = m_ringBuffer.write(m_tmpBuffer+m_tmpTailPos, m_tmpSizeDataWritten-m_tmpTailPos);
+        m_tmpTailPos += nbWrited;
 
-    SAL_DEBUG_READ_FILE("Flushing data from the temporary buffer to the ring buffer done")
+        SAL_DEBUG_READ_FILE("Flushing data from the temporary buffer to the ring buffer done")
+    }
+
+    // Nothing more will be decoded, only the ring buffer is needed until the end of the stream.
+    if (m_endFile && m_tmpTailPos == m_tmpSizeDataWritten)
+        releaseTmpBuffers();
 }
 
 void AbstractAudioFile::updateStreamSizeInfo()
@@ -280,13 +378,18 @@ void AbstractAudioFile::updateStreamSizeInfo()
 size_t AbstractAudioFile::read(char* data, size_t sizeInFrames)
 {
     // Check if the file is open and not at the end.
-    if (!m_isOpen || m_ringBuffer.size() == 0 || m_isEnded)
+    // The main loop may free the ring buffer once the stream is ended.
+    if (m_isEnded || !m_isOpen || m_ringBuffer.size() == 0)
         return 0;
 
     SAL_DEBUG_READ_STREAM("Reading data from the temporary buffer")
     
     // Read data from the ring buffer.
-    size_t sizeInBytes = sizeInFrames * numChannels() * sizeof(float);
+    // The size of the ring buffer is not a multiple of the frame size, only whole frames are read.
+    size_t sizeInBytes = sizeInFrames * streamBytesPerFrame();
+    size_t readableInBytes = m_ringBuffer.readable() / streamBytesPerFrame() * streamBytesPerFrame();
+    if (sizeInBytes > readableInBytes)
+        sizeInBytes = readableInBytes;
     size_t bytesReaded = m_ringBuffer.read(data, sizeInBytes);
     m_streamPos += bytesReaded / sizeof(float) * m_bytesPerSample;
     updateStreamPosInfo();
@@ -313,11 +416,136 @@ size_t AbstractAudioFile::read(char* data, size_t sizeInFrames)
     return bytesReadedInFrames;
 }
 
-void AbstractAudioFile::updateBuffersSize()
+void AbstractAudioFile::setOutputFormat(int numChannels, size_t sampleRate, ResamplerQuality quality)
+{
+    m_isOutputPending = false;
+    if (numChannels == m_numChannels && sampleRate == m_sampleRate)
+    {
+        m_converter.reset();
+        m_outputSampleRate = 0;
+        return;
+    }
+    m_outputSampleRate = sampleRate;
+
+    SAL_DEBUG_STREAM_STATUS("Converting the stream to " + std::to_string(numChannels) +
+        " channels at " + std::to_string(sampleRate) + "Hz")
+
+    if (!m_converter)
+        m_converter.reset(new StreamConverter());
+    m_converter->configure(m_numChannels, m_sampleRate, numChannels, sampleRate, quality);
+}
+
+size_t AbstractAudioFile::readOutput(char* data, size_t sizeInFrames)
+{
+    if (!m_converter)
+        return read(data, sizeInFrames);
+
+    size_t framesWritten = m_converter->process(*this, reinterpret_cast<float*>(data), sizeInFrames);
+    // The resampler output the last frames of the stream after the end of the ring buffer.
+    m_isOutputPending = m_isEnded && !m_converter->isDrained();
+    return framesWritten;
+}
+
+size_t AbstractAudioFile::remainingOutputFrames() const noexcept
+{
+    const size_t position = streamPos();
+    size_t frames = streamSize() > position ? streamSize() - position : 0;
+    const size_t outputSampleRate = m_outputSampleRate;
+    if (outputSampleRate > 0 && m_sampleRate > 0)
+        frames = static_cast<size_t>((double)frames * outputSampleRate / m_sampleRate);
+    return frames;
+}
+
+void AbstractAudioFile::updateBuffersSize(size_t extraFrames)
 {
-    resizeTmpBuffer(sampleRate() * numChannels() * sizeof(float));
-    m_tmpMinimumSize = m_tmpSize;
-    m_ringBuffer.resizeBuffer(sampleRate() * numChannels() * sizeof(float) * 5);
+    m_extraFrames = extraFrames;
+    updatePlannedSizes();
+}
+
+void AbstractAudioFile::setBufferingPolicy(const BufferingPolicy& policy)
+{
+    std::scoped_lock lock(m_readFromFileMutex);
+    m_bufferingPolicy = policy;
+    updatePlannedSizes();
+}
+
+size_t AbstractAudioFile::millisecondsToBytes(size_t ms) const
+{
+    return (size_t)((uint64_t)sampleRate() * ms / 1000) * streamBytesPerFrame();
+}
+
+void AbstractAudioFile::updatePlannedSizes()
+{
+    if (sampleRate() == 0 || numChannels() <= 0)
+        return;
+
+    // The temporary buffer hold at least one frame, plus the data the decoder may write past it.
+    m_tmpMinimumSize = millisecondsToBytes(m_bufferingPolicy.tmpBufferMs);
+    if (m_tmpMinimumSize == 0)
+        m_tmpMinimumSize = streamBytesPerFrame();
+    m_tmpPlannedSize = m_tmpMinimumSize + m_extraFrames * streamBytesPerFrame();
+
+    /*
+    The ring buffer round its size up to a power of two, above the limit
+    the largest power of two under the limit is used instead.
+    */
+    m_ringBufferPlannedSize = millisecondsToBytes(m_bufferingPolicy.ringBufferMs);
+    const size_t maxRingBufferBytes = m_bufferingPolicy.maxRingBufferBytes;
+    if (maxRingBufferBytes > 0 && RingBuffer::storageSize(m_ringBufferPlannedSize) > maxRingBufferBytes)
+    {
+        size_t size = 1;
+        while (size <= maxRingBufferBytes / 2)
+            size <<= 1;
+        m_ringBufferPlannedSize = size;
+    }
+    // At least one frame.
+    if (m_ringBufferPlannedSize < (size_t)streamBytesPerFrame())
+        m_ringBufferPlannedSize = streamBytesPerFrame();
+
+    // The watermarks cannot be higher than the ring buffer.
+    size_t lowWatermarkSize = millisecondsToBytes(m_bufferingPolicy.lowWatermarkMs);
+    size_t highWatermarkSize = millisecondsToBytes(m_bufferingPolicy.highWatermarkMs);
+    m_lowWatermarkSize = lowWatermarkSize < m_ringBufferPlannedSize ? lowWatermarkSize : m_ringBufferPlannedSize;
+    m_highWatermarkSize = highWatermarkSize < m_ringBufferPlannedSize ? highWatermarkSize : m_ringBufferPlannedSize;
+}
+
+void AbstractAudioFile::allocateBuffers()
+{
+    if (m_tmpPlannedSize == 0)
+        return;
+
+    if (!m_tmpBuffer)
+        resizeTmpBuffer(m_tmpPlannedSize);
+    // Enough raw data to fill the temporary buffer.
+    rawBuffer(m_tmpMinimumSize / sizeof(float) * bytesPerSample());
+    if (m_ringBuffer.size() == 0)
+    {
+        SAL_DEBUG_READ_FILE("Allocating the ring buffer")
+        m_ringBuffer.resizeBuffer(m_ringBufferPlannedSize);
+    }
+}
+
+void AbstractAudioFile::releaseTmpBuffers()
+{
+    SAL_DEBUG_READ_FILE("Releasing the temporary buffers")
+
+    delete[] m_tmpBuffer;
+    m_tmpBuffer = nullptr;
+    m_tmpSize = 0;
+    m_tmpTailPos = 0;
+    m_tmpWritePos = 0;
+    m_tmpSizeDataWritten = 0;
+    std::vector<char>().swap(m_rawBuffer);
+}
+
+char* AbstractAudioFile::rawBuffer(size_t size)
+{
+    if (m_rawBuffer.size() < size)
+    {
+        SAL_DEBUG_READ_FILE("Resizing the raw buffer to " + std::to_string(size) + "o")
+        m_rawBuffer.resize(size);
+    }
+    return m_rawBuffer.data();
 }
 
 void AbstractAudioFile::updateStreamPosInfo()
@@ -344,10 +572,18 @@ void AbstractAudioFile::seek(size_t pos)
     // Check if the pos is less than the size of the stream.
     if (pos < streamSize())
     {
+        // The file may be read from the decode pool at the same time.
+        std::scoped_lock lock(m_readFromFileMutex);
+
         SAL_DEBUG_EVENTS("Seeking position " + std::to_string(pos) + " in the stream")
 
         // Clear the ring buffer and move the stream to the new position;
+        // the decoder may write data while seeking, the buffers must be there.
+        allocateBuffers();
         m_ringBuffer.clear();
+        if (m_converter)
+            m_converter->reset();
+        m_isOutputPending = false;
         if (updateReadingPos(pos))
         {
             m_readPos = pos * bytesPerSample() * numChannels();
@@ -1,4 +1,5 @@
 #include "AudioPlayer.h"
+#include "ThreadPool.h"
 #include "Common.h"
 #include "config.h"
 #include <chrono>
@@ -6,9 +7,6 @@
 #include <ratio>
 #include <iostream>
 
-#define SLEEP_PLAYING 10
-#define SLEEP_PAUSED 50
-
 std::string SAL::AudioPlayer::description()
 {
     return SAL_DESCRIPTION;
@@ -35,7 +33,9 @@ bool AudioPlayer::doNotReset = false;
 AudioPlayer::AudioPlayer() :
     m_isInit(false),
     m_isRunning(false),
-    m_sleepTime(SLEEP_PAUSED)
+    m_decodePool(sharedDecodePool()),
+    m_receivedEvents(0),
+    m_coalescedEvents(0)
 {
     SAL_DEBUG_SAL_INIT("Initializing SAL")
 
@@ -61,15 +61,25 @@ AudioPlayer::~AudioPlayer()
 {
     // Removing the ptr from the unique_ptr without
     // deleting the ptr if the user delete the ptr
-    // by itself.
-    if (!doNotReset)
+    // of the default instance by itself.
+    if (!doNotReset && obj.get() == this)
         (void)obj.release();
 
     // Stopping the loop and wait for the thread to stop.
     m_isRunning = false;
+    m_events.wakeUp();
     if (m_loopThread.joinable())
         m_loopThread.join();
 
+    /*
+    The player is destroyed before the event list and the callback interface:
+    its stream and its refill tasks are waking up the main loop and pushing
+    callback calls until the player is destroyed.
+    */
+    m_callbackInterface.setIsReadyGetter(nullptr);
+    m_player.reset();
+    m_pa.reset();
+
     SAL_DEBUG_SAL_INIT("Deinitializing SAL")
 }
 
@@ -120,6 +130,12 @@ void AudioPlayer::initialize()
         m_player = std::unique_ptr<Player>(new Player());
         m_player->setCallbackInterface(&m_callbackInterface);
 
+        // The files are read on the decode pool, not in the main loop.
+        m_player->setDecodePool(m_decodePool);
+
+        // The main loop is sleeping until there is something to do.
+        m_player->setWakeUpCallback(std::bind(&EventList::wakeUp, &m_events));
+
         // Enable the callback interface to get access of some getters of this class.
         m_callbackInterface.setIsReadyGetter(std::bind(&Player::isFileReady, m_player.get()));
     } else
@@ -143,12 +159,6 @@ void AudioPlayer::loop()
     {
         SAL_DEBUG_LOOP_UPDATE("Main loop iteration")
 
-        // Retrieve the time at the beguinning of the loop iteration.
-        const auto timeBegin = std::chrono::system_clock::now();
-
-        // Call the callbacks.
-        m_callbackInterface.callback();
-
         // Processing events.
         processEvents();
 
@@ -156,31 +166,24 @@ void AudioPlayer::loop()
         // playing queue.
         m_player->update();
 
-        // Getting the time the loop iteration take to process.
-        const auto elapsedTime = 
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::system_clock::now() - timeBegin);
-
-        // If the elapsed time is less than the time required between each iteration,
-        // wait required time minus the elapsed time.
-        if (elapsedTime.count() < m_sleepTime) {
-            // Wait time before next iteration.
-            std::this_thread::sleep_for(
-                std::chrono::milliseconds(m_sleepTime - elapsedTime.count()));
-        }
+        /*
+        Sleep until an event is pushed or the stream
+        callback need the ring buffers to be refilled.
+        */
+        m_events.wait(m_player->timeBeforeNextUpdate());
     }
-
-    m_pa.reset();
 }
 
 void AudioPlayer::processEvents()
 {
     SAL_DEBUG_LOOP_UPDATE("Processing pending events")
 
-    while (m_events.containEvents())
-    {
-        EventData event = m_events.get();
+    // Every pending event is processed at once, the superseded ones are skipped.
+    m_receivedEvents += m_events.drain(m_pendingEvents);
+    m_coalescedEvents += coalesceEvents(m_pendingEvents);
 
+    for (const EventData& event : m_pendingEvents)
+    {
         switch (event.type)
         {
         // Open a file
@@ -207,7 +210,6 @@ void AudioPlayer::processEvents()
             SAL_DEBUG_PROCESS_EVENTS("PLAY")
 
             m_player->play();
-            m_sleepTime = SLEEP_PLAYING;
         } break;
 
         // Pause
@@ -216,7 +218,6 @@ void AudioPlayer::processEvents()
             SAL_DEBUG_PROCESS_EVENTS("PAUSE")
 
             m_player->pause();
-            m_sleepTime = SLEEP_PAUSED;
         } break;
 
         // Stop
@@ -225,7 +226,6 @@ void AudioPlayer::processEvents()
             SAL_DEBUG_PROCESS_EVENTS("STOP")
 
             m_player->stop();
-            m_sleepTime = SLEEP_PAUSED;
         } break;
 
         // Seek in seconds
@@ -272,21 +272,99 @@ void AudioPlayer::processEvents()
             m_isRunning = false;
         } break;
         
-        // Invalid event.
+        // Wake up the threads waiting for this event.
         case EventType::WAIT_EVENT:
+        {
+            SAL_DEBUG_PROCESS_EVENTS("WAIT")
+
+            size_t id;
+            try
+            {
+                id = std::get<size_t>(event.data);
+            }
+            catch (const std::bad_variant_access&)
+            {
+                continue;
+            }
+            m_events.setWaitEventProcessed(id);
+        } break;
+
+        // Invalid event.
         case EventType::INVALID:
         default:
         {
-            SAL_DEBUG_PROCESS_EVENTS("WAIT/INVALID")
+            SAL_DEBUG_PROCESS_EVENTS("INVALID")
 
             continue;
         } break;
         }
     }
 
+    // The capacity is kept for the next batch.
+    m_pendingEvents.clear();
+
     SAL_DEBUG_LOOP_UPDATE("Processing pending events done")
 }
 
+size_t AudioPlayer::coalesceEvents(std::vector<EventData>& events)
+{
+    size_t coalesced = 0;
+    bool isSeekSuperseded = false;
+    bool isPlayPauseSuperseded = false;
+
+    /*
+    Going backward, a seek or a play/pause is superseded when
+    a later one of the same kind is reached with only seeks and
+    play/pause in between. Any other event (opening a file, stop,
+    next, wait, ...) need the events before it to be processed.
+    */
+    for (std::vector<EventData>::reverse_iterator it = events.rbegin();
+         it != events.rend();
+         it++)
+    {
+        switch (it->type)
+        {
+        case EventType::SEEK:
+        case EventType::SEEK_SECONDS:
+        {
+            if (isSeekSuperseded)
+            {
+                it->type = EventType::INVALID;
+                coalesced++;
+            }
+            isSeekSuperseded = true;
+        } break;
+
+        case EventType::PLAY:
+        case EventType::PAUSE:
+        {
+            if (isPlayPauseSuperseded)
+            {
+                it->type = EventType::INVALID;
+                coalesced++;
+            }
+            isPlayPauseSuperseded = true;
+        } break;
+
+        case EventType::INVALID:
+            break;
+
+        default:
+        {
+            isSeekSuperseded = false;
+            isPlayPauseSuperseded = false;
+        } break;
+        }
+    }
+
+    if (coalesced > 0)
+    {
+        SAL_DEBUG_EVENTS(std::to_string(coalesced) + " events coalesced")
+    }
+
+    return coalesced;
+}
+
 bool AudioPlayer::isPlaying(bool isWaiting)
 {
     if (isRunning())
@@ -323,17 +401,29 @@ bool AudioPlayer::isReady(bool isWaiting)
         return false;
 }
 
+std::shared_ptr<ThreadPool> AudioPlayer::sharedDecodePool()
+{
+    static std::mutex poolMutex;
+    static std::weak_ptr<ThreadPool> sharedPool;
+
+    std::scoped_lock lock(poolMutex);
+    std::shared_ptr<ThreadPool> pool = sharedPool.lock();
+    if (!pool)
+    {
+        pool = std::make_shared<ThreadPool>();
+        sharedPool = pool;
+    }
+    return pool;
+}
+
 void AudioPlayer::waitEvent()
 {
     /*
     Push an wait event id into the event queue
     and wait until it disappear.
     */
-    int id = m_events.waitEvent();
-    while (m_events.isWaitEventIDPresent(id))
-    {
-        std::this_thread::sleep_for(std::chrono::microseconds(m_sleepTime));
-    }
+    size_t id = m_events.waitEvent();
+    m_events.waitUntilProcessed(id);
 }
 
 std::string AudioPlayer::getAudioBackendName(BackendAudio backend)
@@ -0,0 +1,27 @@
+#include "AudioSink.h"
+#include "PortAudioSink.h"
+#include "NullAudioSink.h"
+#include "WaveFileSink.h"
+
+namespace SAL
+{
+AudioSink::AudioSink()
+{}
+
+AudioSink::~AudioSink()
+{}
+
+AudioSink* AudioSink::create(const AudioSinkConfig& config, int hostApiType)
+{
+    switch (config.type)
+    {
+    case AudioSinkType::NULL_SINK:
+        return new NullAudioSink(config.speed, config.framesPerBuffer);
+    case AudioSinkType::WAVE_FILE:
+        return new WaveFileSink(config.filePath, config.speed, config.framesPerBuffer);
+    case AudioSinkType::PORTAUDIO:
+    default:
+        return new PortAudioSink(hostApiType);
+    }
+}
+}
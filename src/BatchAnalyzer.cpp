@@ -0,0 +1,184 @@
+#include "BatchAnalyzer.h"
+#include "ThreadPool.h"
+#include "Decoder.h"
+#include "FormatProbe.h"
+#include "DebugLog.h"
+#include <cmath>
+
+// Number of frames decoded at once by a worker.
+#define BATCH_BLOCK_FRAMES 16384
+
+// Parameters of the 64 bits FNV-1a hash.
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "BatchAnalyzer";
+
+namespace SAL
+{
+BatchAnalyzer::BatchAnalyzer(int threadCount) :
+    m_pool(new ThreadPool(threadCount)),
+    m_pendingFiles(0),
+    m_isCancelled(false)
+{}
+
+BatchAnalyzer::~BatchAnalyzer()
+{
+    cancel();
+    m_pool.reset();
+}
+
+void BatchAnalyzer::setResultCallback(ResultCallback callback)
+{
+    std::scoped_lock lock(m_callbackMutex);
+    m_resultCallback = callback;
+}
+
+void BatchAnalyzer::setFinishedCallback(FinishedCallback callback)
+{
+    std::scoped_lock lock(m_callbackMutex);
+    m_finishedCallback = callback;
+}
+
+void BatchAnalyzer::analyze(const std::vector<std::string>& filePaths)
+{
+    SAL_DEBUG("Analyzing " + std::to_string(filePaths.size()) + " files")
+
+    m_pendingFiles.fetch_add(filePaths.size());
+    for (const std::string& filePath : filePaths)
+        m_pool->submit(std::bind(&BatchAnalyzer::runTask, this, filePath));
+}
+
+void BatchAnalyzer::wait()
+{
+    std::unique_lock lock(m_waitMutex);
+    m_waitCV.wait(lock, [this]() { return m_pendingFiles.load() == 0; });
+}
+
+void BatchAnalyzer::cancel()
+{
+    SAL_DEBUG("Cancelling the analysis")
+
+    // The remaining tasks are only decrementing the pending files.
+    m_isCancelled = true;
+    wait();
+    m_isCancelled = false;
+}
+
+void BatchAnalyzer::runTask(const std::string& filePath)
+{
+    // The flag is read before decrementing the pending files: cancel() clears it
+    // as soon as they reach 0, a later read would send the callbacks after it returned.
+    bool isCancelled = m_isCancelled;
+    if (!isCancelled)
+    {
+        AnalysisResult result = analyzeFile(filePath, &m_isCancelled);
+        isCancelled = m_isCancelled;
+        if (!isCancelled)
+        {
+            std::scoped_lock lock(m_callbackMutex);
+            if (m_resultCallback)
+                m_resultCallback(result);
+        }
+    }
+
+    // The last file of the batch.
+    if (m_pendingFiles.fetch_sub(1) == 1)
+    {
+        if (!isCancelled)
+        {
+            std::scoped_lock lock(m_callbackMutex);
+            if (m_finishedCallback)
+                m_finishedCallback();
+        }
+
+        {
+            std::scoped_lock lock(m_waitMutex);
+        }
+        m_waitCV.notify_all();
+    }
+}
+
+AnalysisResult BatchAnalyzer::analyzeFile(const std::string& filePath)
+{
+    return analyzeFile(filePath, nullptr);
+}
+
+AnalysisResult BatchAnalyzer::analyzeFile(const std::string& filePath, const std::atomic<bool>* isCancelled)
+{
+    AnalysisResult result;
+    result.filePath = filePath;
+
+    // Only reading the magic bytes, the files not readable are rejected without opening a decoder.
+    result.type = FormatProbe::probe(filePath);
+    if (result.type == UNKNOWN_FILE)
+    {
+        result.error = "unknown file format";
+        return result;
+    }
+
+    Decoder decoder;
+    if (!decoder.open(filePath))
+    {
+        result.error = "cannot decode the file";
+        return result;
+    }
+
+    const int channels = decoder.numChannels();
+    result.sampleRate = decoder.sampleRate();
+    result.numChannels = channels;
+    result.peaks.assign(channels, 0.0f);
+    std::vector<double> sumSquares(channels, 0.0);
+    uint64_t checksum = FNV_OFFSET_BASIS;
+
+    // The block is reused by every file analyzed by the worker.
+    thread_local std::vector<float> block;
+    block.resize(BATCH_BLOCK_FRAMES * channels);
+
+    size_t frames;
+    while ((frames = decoder.read(block.data(), BATCH_BLOCK_FRAMES)) > 0)
+    {
+        if (isCancelled && isCancelled->load(std::memory_order_relaxed))
+        {
+            result.error = "cancelled";
+            return result;
+        }
+
+        const float* sample = block.data();
+        for (size_t i = 0; i < frames; i++)
+        {
+            for (int c = 0; c < channels; c++, sample++)
+            {
+                float value = std::fabs(*sample);
+                if (value > result.peaks[c])
+                    result.peaks[c] = value;
+                sumSquares[c] += (double)*sample * *sample;
+            }
+        }
+
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(block.data());
+        const size_t size = frames * channels * sizeof(float);
+        for (size_t i = 0; i < size; i++)
+        {
+            checksum ^= bytes[i];
+            checksum *= FNV_PRIME;
+        }
+
+        result.frames += frames;
+    }
+
+    result.rms.assign(channels, 0.0f);
+    if (result.frames > 0)
+    {
+        for (int c = 0; c < channels; c++)
+            result.rms[c] = (float)std::sqrt(sumSquares[c] / result.frames);
+    }
+    if (result.sampleRate > 0)
+        result.duration = (double)result.frames / result.sampleRate;
+    result.checksum = checksum;
+    result.isValid = true;
+
+    return result;
+}
+}
@@ -1,5 +1,17 @@
 #include "CallbackInterface.h"
 #include "DebugLog.h"
+#include <limits>
+#include <algorithm>
+#include <iterator>
+
+// Maximum number of callback calls waiting to be dispatched.
+#define CALLBACK_QUEUE_SIZE 1024
+// Default number of stream position callbacks per second.
+#define STREAM_POS_CHANGE_FREQUENCY 30
+// Longest wait of the dispatcher, a wake up missed while it is entering the wait is caught by this timeout.
+#define DISPATCHER_MAX_WAIT_TIME std::chrono::milliseconds(50)
+// Number of bits of the stream position packed with the sample rate, the upper bits store the sample rate.
+#define STREAM_POS_BITS 40
 
 // Define CLASS_NAME to have the name of the class.
 const std::string CLASS_NAME = "CallbackInterface";
@@ -7,50 +19,77 @@ const std::string CLASS_NAME = "CallbackInterface";
 namespace SAL
 {
 CallbackInterface::CallbackInterface() :
+    m_callbackQueue(CALLBACK_QUEUE_SIZE),
+    m_hasOverflowCalls(false),
+    m_isDispatcherWaiting(false),
+    m_isDispatcherStopping(false),
+    m_isDispatcherIdle(false),
+    m_streamPosAndSampleRate(0),
+    m_isStreamPosPending(false),
+    m_streamPosChangeFrequency(STREAM_POS_CHANGE_FREQUENCY),
+    m_streamPosLastCallback(std::numeric_limits<size_t>::max()),
+    m_streamPosLastCallbackInSeconds(std::numeric_limits<size_t>::max()),
     m_isReadyLastStatus(false)
 {
     // Calling the isReadyChanged signal every time the state of
-    // the simple-audio-library is changing.
+    // the simple-audio-library is changing. It is called from
+    // the dispatcher thread, the call is only pushed into the queue.
     auto callIsReadyChanged = [this]()->void {
+        std::scoped_lock lock(this->m_isReadyGetterMutex);
+        if (!this->m_isReadyGetter)
+            return;
         bool isReady = this->m_isReadyGetter();
         if (isReady != this->m_isReadyLastStatus)
-        {
-            std::scoped_lock lock(this->m_backgroundThreadMutex);
-            this->m_backgroundThread.push_back(std::thread(
-                &CallbackInterface::callIsReadyChangedCallback, this, isReady));
-        }
+            this->callIsReadyChangedCallback(isReady);
     };
     addStartFileCallback(std::bind(callIsReadyChanged));
     addEndFileCallback(std::bind(callIsReadyChanged));
     addStreamPlayingCallback(callIsReadyChanged);
     addStreamStoppingCallback(callIsReadyChanged);
+
+    m_dispatcherThread = std::thread(&CallbackInterface::dispatcherLoop, this);
 }
 
 CallbackInterface::~CallbackInterface()
 {
-    // Join the threads.
-    std::scoped_lock btLock(m_backgroundThreadMutex);
-    for (int i = 0; i < m_backgroundThread.size(); i++)
+    // Stop the dispatcher thread once the pending calls are dispatched.
     {
-        if (m_backgroundThread.at(i).joinable())
-            m_backgroundThread[i].join();
+        std::scoped_lock lock(m_dispatcherMutex);
+        m_isDispatcherStopping = true;
     }
+    m_dispatcherCV.notify_one();
+    if (m_dispatcherThread.joinable())
+        m_dispatcherThread.join();
+}
+
+/*
+Template function to add a callback to a given array.
+The array is never modified, it is copied with the new callback
+and replaced under its mutex. This way the dispatcher can call
+a snapshot of the array without copying it.
+*/
+template<typename Callback>
+inline void addCallbackTemplate(std::shared_ptr<const std::vector<Callback>>& callbackArray, std::mutex& mutex, const Callback& callback)
+{
+    std::scoped_lock lock(mutex);
+    std::shared_ptr<std::vector<Callback>> callbacks = callbackArray ?
+        std::make_shared<std::vector<Callback>>(*callbackArray) : std::make_shared<std::vector<Callback>>();
+    callbacks->push_back(callback);
+    callbackArray = callbacks;
 }
 
 void CallbackInterface::addStartFileCallback(StartFileCallback callback)
 {
     SAL_DEBUG_EVENTS("Adding a start file callback")
 
-    std::scoped_lock lock(m_startFileCallbackMutex);
-    m_startFileCallback.push_back(callback);
+    addCallbackTemplate(m_startFileCallback, m_startFileCallbackMutex, callback);
 }
 
 void CallbackInterface::addEndFileCallback(EndFileCallback callback)
 {
     SAL_DEBUG_EVENTS("Adding a end file callback")
 
-    std::scoped_lock lock(m_endFileCallbackMutex);
-    m_endFileCallback.push_back(callback);
+    addCallbackTemplate(m_endFileCallback, m_endFileCallbackMutex, callback);
 }
 
 void CallbackInterface::addStreamPosChangeCallback(StreamPosChangeCallback callback, TimeType timeType)
@@ -58,397 +97,433 @@ void CallbackInterface::addStreamPosChangeCallback(StreamPosChangeCallback callb
     SAL_DEBUG_EVENTS(std::string("Adding a stream pos in ") + (timeType == TimeType::FRAMES ? "frames" : "seconds") + std::string(" change callback"))
 
     if (timeType == TimeType::SECONDS)
-    {
-        std::scoped_lock lock(m_streamPosChangeMutex);
-        m_streamPosChangeCallback.push_back(callback);
-    }
+        addCallbackTemplate(m_streamPosChangeCallback, m_streamPosChangeMutex, callback);
     else
-    {
-        std::scoped_lock lock(m_streamPosChangeInFramesMutex);
-        m_streamPosChangeInFramesCallback.push_back(callback);
-    }
+        addCallbackTemplate(m_streamPosChangeInFramesCallback, m_streamPosChangeInFramesMutex, callback);
 }
 
 void CallbackInterface::addStreamPausedCallback(StreamPausedCallback callback)
 {
     SAL_DEBUG_EVENTS("Add stream paused callback")
 
-    std::scoped_lock lock(m_streamPausedMutex);
-    m_streamPausedCallback.push_back(callback);
+    addCallbackTemplate(m_streamPausedCallback, m_streamPausedMutex, callback);
 }
 
 void CallbackInterface::addStreamPlayingCallback(StreamPlayingCallback callback)
 {
     SAL_DEBUG_EVENTS("Add stream playing callback")
 
-    std::scoped_lock lock(m_streamPlayingMutex);
-    m_streamPlayingCallback.push_back(callback);
+    addCallbackTemplate(m_streamPlayingCallback, m_streamPlayingMutex, callback);
 }
 
 void CallbackInterface::addStreamStoppingCallback(StreamStoppingCallback callback)
 {
     SAL_DEBUG_EVENTS("Add stream stopping callback")
 
-    std::scoped_lock lock(m_streamStoppingMutex);
-    m_streamStoppingCallback.push_back(callback);
+    addCallbackTemplate(m_streamStoppingCallback, m_streamStoppingMutex, callback);
 }
 
 void CallbackInterface::addStreamBufferingCallback(StreamBufferingCallback callback)
 {
     SAL_DEBUG_EVENTS("Add stream buffering callback")
 
-    std::scoped_lock lock(m_streamBufferingMutex);
-    m_streamBufferingCallback.push_back(callback);
+    addCallbackTemplate(m_streamBufferingCallback, m_streamBufferingMutex, callback);
 }
 
 void CallbackInterface::addStreamEnoughBufferingCallback(StreamEnoughBufferingCallback callback)
 {
     SAL_DEBUG_EVENTS("Add stream enough buffering callback")
 
-    std::scoped_lock lock(m_streamEnoughBufferingMutex);
-    m_streamEnoughBufferingCallback.push_back(callback);
+    addCallbackTemplate(m_streamEnoughBufferingCallback, m_streamEnoughBufferingMutex, callback);
 }
 
 void CallbackInterface::addIsReadyChangedCallback(IsReadyChangedCallback callback)
 {
     SAL_DEBUG_EVENTS("Add is ready changed callback")
 
-    std::scoped_lock lock(m_isReadyChangedMutex);
-    m_isReadyChangedCallback.push_back(callback);
+    addCallbackTemplate(m_isReadyChangedCallback, m_isReadyChangedMutex, callback);
 }
 
 void CallbackInterface::callStartFileCallback(const std::string& filePath)
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::START_FILE, filePath});
+    pushCallbackCall({CallbackType::START_FILE, filePath});
 }
 
 void CallbackInterface::callEndFileCallback(const std::string& filePath)
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::END_FILE, filePath});
+    pushCallbackCall({CallbackType::END_FILE, filePath});
 }
 
-void CallbackInterface::callStreamPosChangeCallback(size_t streamPos, TimeType timeType)
+void CallbackInterface::setStreamPos(size_t streamPos, size_t sampleRate)
 {
-    // Frames are placed first, because they will be called more often than seconds.
-    if (timeType == TimeType::FRAMES)
-    {
-        std::scoped_lock lock(m_callbackCallMutex);
-        m_callbackCall.push_back({CallbackType::STREAM_POS_CHANGE_IN_FRAME, streamPos});
-    }
-    else
-    {
-        std::scoped_lock lock(m_callbackCallMutex);
-        m_callbackCall.push_back({CallbackType::STREAM_POS_CHANGE, streamPos});
-    }
+    // Only the latest position is kept, with its sample rate in the same atomic.
+    const uint64_t streamPosMask = ((uint64_t)1 << STREAM_POS_BITS) - 1;
+    m_streamPosAndSampleRate.store(((uint64_t)sampleRate << STREAM_POS_BITS) | ((uint64_t)streamPos & streamPosMask),
+        std::memory_order_relaxed);
+
+    // The dispatcher is only woken up when it stopped looking at the position.
+    if (!m_isStreamPosPending.exchange(true) && m_isDispatcherIdle.load())
+        notifyDispatcher();
 }
 
 void CallbackInterface::callStreamPausedCallback()
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::STREAM_PAUSED});
+    pushCallbackCall({CallbackType::STREAM_PAUSED});
 }
 
 void CallbackInterface::callStreamPlayingCallback()
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::STREAM_PLAYING});
+    pushCallbackCall({CallbackType::STREAM_PLAYING});
 }
 
 void CallbackInterface::callStreamStoppingCallback()
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::STREAM_STOPPING});
+    pushCallbackCall({CallbackType::STREAM_STOPPING});
 }
 
 void CallbackInterface::callStreamBufferingCallback()
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::STREAM_BUFFERING});
+    pushCallbackCall({CallbackType::STREAM_BUFFERING});
 }
 
 void CallbackInterface::callStreamEnoughBufferingCallback()
 {
-    std::scoped_lock lock(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::STREAM_ENOUGH_BUFFERING});
+    pushCallbackCall({CallbackType::STREAM_ENOUGH_BUFFERING});
 }
 
 void CallbackInterface::callIsReadyChangedCallback(bool isReady)
 {
-    std::scoped_lock lack(m_callbackCallMutex);
-    m_callbackCall.push_back({CallbackType::IS_READY_CHANCHED, isReady});
+    pushCallbackCall({CallbackType::IS_READY_CHANCHED, isReady});
+}
+
+void CallbackInterface::pushCallbackCall(const CallbackData& data)
+{
+    /*
+    The calls are never dropped, if the dispatcher is too late they are
+    stored in the overflow list. Once the overflow list is used, the
+    next calls are stored after it to keep their order.
+    */
+    if (m_hasOverflowCalls.load() || !m_callbackQueue.push(data))
+    {
+        SAL_DEBUG_EVENTS("Callback queue full, storing the call in the overflow list")
+
+        std::scoped_lock lock(m_overflowCallsMutex);
+        m_overflowCalls.push_back(data);
+        m_hasOverflowCalls = true;
+    }
+
+    if (m_isDispatcherWaiting.load())
+        notifyDispatcher();
 }
 
-void CallbackInterface::callback() 
+void CallbackInterface::notifyDispatcher()
 {
-    SAL_DEBUG_LOOP_UPDATE("Processing callbacks")
+    /*
+    Either the dispatcher see the new call or position, or this thread
+    see the dispatcher waiting. The mutex is not locked, this method is
+    called from the stream callback: if the dispatcher is not inside
+    the wait yet, the wake up is caught by its timeout.
+    */
+    m_dispatcherCV.notify_one();
+}
 
-    std::scoped_lock lock(m_callbackCallMutex);
-    for (const CallbackData& data : m_callbackCall)
+void CallbackInterface::dispatcherLoop()
+{
+    std::chrono::steady_clock::time_point nextStreamPosDispatch = std::chrono::steady_clock::now();
+    while (true)
     {
-        switch (data.type)
-        {
-        /*
-        If it's a Start File callback, retrieving the
-        string (filePath) inside it and call the start callback.
-        */
-        case CallbackType::START_FILE:
-        {
-            std::string filePath;
-            try
-            {
-                filePath = std::get<std::string>(data.data);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-            startFileCallback(filePath);
-        } break;
-
-        /*
-        If it's a End File callback, retrieving the string (filePath)
-        inside it and call the end callback.
-        */
-        case CallbackType::END_FILE:
-        {
-            std::string filePath;
-            try
-            {
-                filePath = std::get<std::string>(data.data);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-            endFileCallback(filePath);
-        } break;
-
-        /*
-        If it's a Stream pos change in frames, retrieving the position
-        inside it and call the callback.
-        */
-        case CallbackType::STREAM_POS_CHANGE_IN_FRAME:
+        SAL_DEBUG_LOOP_UPDATE("Processing callbacks")
+
+        dispatchCallbackCalls();
+
+        // The stream position is dispatched at most at the stream position change frequency.
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (now >= nextStreamPosDispatch && m_isStreamPosPending.exchange(false))
         {
-            size_t streamPos;
-            try
-            {
-                streamPos = std::get<size_t>(data.data);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-            streamPosChangeInFramesCallback(streamPos);
-        } break;
-
-        /*
-        If it's a Stream pos change, retrieving the position inside it
-        and call the callback.
-        */
-        case CallbackType::STREAM_POS_CHANGE:
+            dispatchStreamPos();
+            int frequency = m_streamPosChangeFrequency;
+            nextStreamPosDispatch = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(1.0 / frequency));
+        }
+
+        SAL_DEBUG_LOOP_UPDATE("Processing callbacks done")
+
+        std::unique_lock lock(m_dispatcherMutex);
+        if (m_isDispatcherStopping)
+            break;
+
+        m_isDispatcherWaiting.store(true);
+        if (m_isStreamPosPending.load())
         {
-            size_t streamPos;
-            try
-            {
-                streamPos = std::get<size_t>(data.data);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-            streamPosChangeCallback(streamPos);
-        } break;
-
-        /*
-        If it's a stream paused, call the stream paused callback.
-        */
-        case CallbackType::STREAM_PAUSED:
+            // A position is waiting for its turn, only the callback calls are waking up the dispatcher.
+            m_dispatcherCV.wait_until(lock, std::min(nextStreamPosDispatch, now + DISPATCHER_MAX_WAIT_TIME), [this]() {
+                return !m_callbackQueue.empty() || m_hasOverflowCalls.load() || m_isDispatcherStopping; });
+        }
+        else
         {
-            streamPausedCallback();
-        } break;
+            m_isDispatcherIdle.store(true);
+            m_dispatcherCV.wait_for(lock, DISPATCHER_MAX_WAIT_TIME, [this]() {
+                return !m_callbackQueue.empty() || m_hasOverflowCalls.load() || m_isDispatcherStopping || m_isStreamPosPending.load(); });
+            m_isDispatcherIdle.store(false, std::memory_order_relaxed);
+        }
+        m_isDispatcherWaiting.store(false, std::memory_order_relaxed);
+    }
 
-        /*
-        If it's a stream playing, call the stream playing callback.
-        */
-        case CallbackType::STREAM_PLAYING:
-        {
-            streamPlayingCallback();
-        } break;
+    // Dispatch the calls pushed while stopping.
+    dispatchCallbackCalls();
+}
 
-        /*
-        If it's a stream stopping, call the stream stopping callback.
-        */
-        case CallbackType::STREAM_STOPPING:
-        {
-            streamStoppingCallback();
-        } break;
+void CallbackInterface::dispatchCallbackCalls()
+{
+    CallbackData data;
+    while (m_callbackQueue.pop(data))
+        dispatch(data);
 
-        /*
-        If it's a stream buffering, call the stream buffering callback.
-        */
-        case CallbackType::STREAM_BUFFERING:
+    // The calls of the overflow list were pushed after the calls of the queue.
+    if (m_hasOverflowCalls.load())
+    {
+        std::vector<CallbackData> overflowCalls;
         {
-            streamBufferingCallback();
-        } break;
+            std::scoped_lock lock(m_overflowCallsMutex);
+            overflowCalls.swap(m_overflowCalls);
+            m_hasOverflowCalls = false;
+        }
+        for (const CallbackData& overflowData : overflowCalls)
+            dispatch(overflowData);
+    }
+}
 
-        /*
-        If it's a stream enough buffering, call the stream enough buffering callback.
-        */
-        case CallbackType::STREAM_ENOUGH_BUFFERING:
-        {
-            streamEnoughBufferingCallback();
-        } break;
+void CallbackInterface::dispatchStreamPos()
+{
+    const uint64_t streamPosAndSampleRate = m_streamPosAndSampleRate.load(std::memory_order_relaxed);
+    const size_t streamPos = static_cast<size_t>(streamPosAndSampleRate & (((uint64_t)1 << STREAM_POS_BITS) - 1));
+    const size_t sampleRate = static_cast<size_t>(streamPosAndSampleRate >> STREAM_POS_BITS);
+
+    if (streamPos != m_streamPosLastCallback)
+    {
+        m_streamPosLastCallback = streamPos;
+        streamPosChangeInFramesCallback(streamPos);
+    }
+
+    if (sampleRate > 0 && streamPos / sampleRate != m_streamPosLastCallbackInSeconds)
+    {
+        m_streamPosLastCallbackInSeconds = streamPos / sampleRate;
+        streamPosChangeCallback(m_streamPosLastCallbackInSeconds);
+    }
+}
 
-        /*
-        If it's a is ready changed, call the is ready changed callback.
-        */
-        case CallbackType::IS_READY_CHANCHED:
+void CallbackInterface::dispatch(const CallbackData& data)
+{
+    switch (data.type)
+    {
+    /*
+    If it's a Start File callback, retrieving the
+    string (filePath) inside it and call the start callback.
+    */
+    case CallbackType::START_FILE:
+    {
+        std::string filePath;
+        try
         {
-            bool isReady;
-            try
-            {
-                isReady = std::get<bool>(data.data);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-            if (isReady != m_isReadyLastStatus)
-            {
-                isReadyChangedCallback(isReady);
-                m_isReadyLastStatus = isReady;
-            }
-        } break;
-
-        /*
-        If the callback type is unknown, do nothing.
-        */
-        case CallbackType::UNKNOWN:
-        default:
+            filePath = std::get<std::string>(data.data);
+        }
+        catch (const std::bad_variant_access&)
         {
-            continue;
-        } break;
+            return;
         }
-    }
-    m_callbackCall.clear();
+        startFileCallback(filePath);
+    } break;
+
+    /*
+    If it's a End File callback, retrieving the string (filePath)
+    inside it and call the end callback.
+    */
+    case CallbackType::END_FILE:
+    {
+        std::string filePath;
+        try
+        {
+            filePath = std::get<std::string>(data.data);
+        }
+        catch (const std::bad_variant_access&)
+        {
+            return;
+        }
+        endFileCallback(filePath);
+    } break;
+
+    /*
+    If it's a stream paused, call the stream paused callback.
+    */
+    case CallbackType::STREAM_PAUSED:
+    {
+        streamPausedCallback();
+    } break;
+
+    /*
+    If it's a stream playing, call the stream playing callback.
+    */
+    case CallbackType::STREAM_PLAYING:
+    {
+        streamPlayingCallback();
+    } break;
 
-    SAL_DEBUG_LOOP_UPDATE("Removing unneeded threads")
+    /*
+    If it's a stream stopping, call the stream stopping callback.
+    */
+    case CallbackType::STREAM_STOPPING:
+    {
+        streamStoppingCallback();
+    } break;
+
+    /*
+    If it's a stream buffering, call the stream buffering callback.
+    */
+    case CallbackType::STREAM_BUFFERING:
+    {
+        streamBufferingCallback();
+    } break;
+
+    /*
+    If it's a stream enough buffering, call the stream enough buffering callback.
+    */
+    case CallbackType::STREAM_ENOUGH_BUFFERING:
+    {
+        streamEnoughBufferingCallback();
+    } break;
 
-    // Remove unneeded threads.
-    std::scoped_lock btLock(m_backgroundThreadMutex);
-    for (std::vector<std::thread>::const_reverse_iterator crit = m_backgroundThread.crbegin();
-         crit != m_backgroundThread.crend();
-         crit++)
+    /*
+    If it's a is ready changed, call the is ready changed callback.
+    */
+    case CallbackType::IS_READY_CHANCHED:
     {
-        if (!crit->joinable())
+        bool isReady;
+        try
+        {
+            isReady = std::get<bool>(data.data);
+        }
+        catch (const std::bad_variant_access&)
         {
-            m_backgroundThread.erase((crit+1).base());
+            return;
         }
+        if (isReady != m_isReadyLastStatus)
+        {
+            isReadyChangedCallback(isReady);
+            m_isReadyLastStatus = isReady;
+        }
+    } break;
+
+    /*
+    If the callback type is unknown, do nothing.
+    */
+    case CallbackType::UNKNOWN:
+    default:
+        break;
     }
-
-    SAL_DEBUG_LOOP_UPDATE("Processing callbacks done")
 }
 
 /*
 Template function to call a callback with an argument.
 This function call every callback of a given array and
 remove the invalid callback.
+The snapshot of the array is taken under its mutex and the callbacks
+are called without it, a slow callback or a callback adding another
+callback does not block the add methods.
 */
-template<typename CallbackArrayType, typename... Args>
-inline void callbackCallTemplate(CallbackArrayType& callbackArray, const Args&... args)
+template<typename Callback, typename... Args>
+inline void callbackCallTemplate(std::shared_ptr<const std::vector<Callback>>& callbackArray, std::mutex& mutex, const Args&... args)
 {
-    std::vector<typename CallbackArrayType::iterator> indexToRemove;
+    std::shared_ptr<const std::vector<Callback>> callbacks;
+    {
+        std::scoped_lock lock(mutex);
+        callbacks = callbackArray;
+    }
+    if (!callbacks)
+        return;
 
-    // Iterate through the callback list.
-    for (typename CallbackArrayType::iterator it = callbackArray.begin();
-         it != callbackArray.end();
-         it++)
+    bool hasInvalidCallback = false;
+    for (const Callback& callback : *callbacks)
     {
         try
         {
             // Call the function/method stored inside the std::function.
-            (*it)(args...);
+            callback(args...);
         }
         catch (const std::bad_function_call&)
         {
-            // If the call failed, store the iterator inside the list to be removed.
-            indexToRemove.push_back(it);
+            hasInvalidCallback = true;
         }
     }
 
-    // Removing the bad method.
-    for (typename std::vector<typename CallbackArrayType::iterator>::const_reverse_iterator crit = indexToRemove.crbegin();
-         crit != indexToRemove.crend();
-         crit++)
+    // Removing the bad method, the array may have been replaced since the snapshot.
+    if (hasInvalidCallback)
     {
-        callbackArray.erase(*(crit+1));
+        std::scoped_lock lock(mutex);
+        std::shared_ptr<std::vector<Callback>> validCallbacks = std::make_shared<std::vector<Callback>>();
+        std::copy_if(callbackArray->cbegin(), callbackArray->cend(), std::back_inserter(*validCallbacks),
+            [](const Callback& callback) { return static_cast<bool>(callback); });
+        callbackArray = validCallbacks;
     }
 }
 
 void CallbackInterface::startFileCallback(const std::string& filePath)
 {
-    std::scoped_lock lock(m_startFileCallbackMutex);
-    callbackCallTemplate(m_startFileCallback, filePath);
+    callbackCallTemplate(m_startFileCallback, m_startFileCallbackMutex, filePath);
 }
 
 void CallbackInterface::endFileCallback(const std::string& filePath)
 {
-    std::scoped_lock lock(m_endFileCallbackMutex);
-    callbackCallTemplate(m_endFileCallback, filePath);
+    callbackCallTemplate(m_endFileCallback, m_endFileCallbackMutex, filePath);
 }
 
 void CallbackInterface::streamPosChangeInFramesCallback(size_t streamPos)
 {
-    std::scoped_lock lock(m_streamPosChangeInFramesMutex);
-    callbackCallTemplate(m_streamPosChangeInFramesCallback, streamPos);
+    callbackCallTemplate(m_streamPosChangeInFramesCallback, m_streamPosChangeInFramesMutex, streamPos);
 }
 
 void CallbackInterface::streamPosChangeCallback(size_t streamPos)
 {
-    std::scoped_lock lock(m_streamPosChangeMutex);
-    callbackCallTemplate(m_streamPosChangeCallback, streamPos);
+    callbackCallTemplate(m_streamPosChangeCallback, m_streamPosChangeMutex, streamPos);
 }
 
 void CallbackInterface::streamPausedCallback()
 {
-    std::scoped_lock lock(m_streamPausedMutex);
-    callbackCallTemplate(m_streamPausedCallback);
+    callbackCallTemplate(m_streamPausedCallback, m_streamPausedMutex);
 }
 
 void CallbackInterface::streamPlayingCallback()
 {
-    std::scoped_lock lock(m_streamPlayingMutex);
-    callbackCallTemplate(m_streamPlayingCallback);
+    callbackCallTemplate(m_streamPlayingCallback, m_streamPlayingMutex);
 }
 
 void CallbackInterface::streamStoppingCallback()
 {
-    std::scoped_lock lock(m_streamStoppingMutex);
-    callbackCallTemplate(m_streamStoppingCallback);
+    callbackCallTemplate(m_streamStoppingCallback, m_streamStoppingMutex);
 }
 
 void CallbackInterface::streamBufferingCallback()
 {
-    std::scoped_lock lock(m_streamBufferingMutex);
-    callbackCallTemplate(m_streamBufferingCallback);
+    callbackCallTemplate(m_streamBufferingCallback, m_streamBufferingMutex);
 }
 
 void CallbackInterface::streamEnoughBufferingCallback()
 {
-    std::scoped_lock lock(m_streamEnoughBufferingMutex);
-    callbackCallTemplate(m_streamEnoughBufferingCallback);
+    callbackCallTemplate(m_streamEnoughBufferingCallback, m_streamEnoughBufferingMutex);
 }
 
 void CallbackInterface::isReadyChangedCallback(bool isReady)
 {
-    std::scoped_lock lock(m_isReadyChangedMutex);
-    callbackCallTemplate(m_isReadyChangedCallback, isReady);
+    callbackCallTemplate(m_isReadyChangedCallback, m_isReadyChangedMutex, isReady);
 }
 
 void CallbackInterface::setIsReadyGetter(std::function<bool()> getter)
 {
+    std::scoped_lock lock(m_isReadyGetterMutex);
     m_isReadyGetter = getter;
 }
+
+void CallbackInterface::setStreamPosChangeFrequency(int frequency)
+{
+    m_streamPosChangeFrequency = frequency > 0 ? frequency : 1;
+}
 }
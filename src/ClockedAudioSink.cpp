@@ -0,0 +1,142 @@
+#include "ClockedAudioSink.h"
+#include "DebugLog.h"
+#include <chrono>
+
+// Default number of frames asked to the stream callback at once.
+#define CLOCKED_SINK_FRAMES 512
+// Time let to the main loop to refill the buffers when buffering as fast as possible.
+#define CLOCKED_SINK_BUFFERING_WAIT std::chrono::milliseconds(1)
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "ClockedAudioSink";
+
+namespace SAL
+{
+ClockedAudioSink::ClockedAudioSink(double speed, size_t framesPerBuffer) :
+    m_speed(speed > 0.0 ? speed : 0.0),
+    m_framesPerBuffer(framesPerBuffer > 0 ? framesPerBuffer : CLOCKED_SINK_FRAMES),
+    m_numChannels(0),
+    m_sampleRate(0),
+    m_streamCallback(nullptr),
+    m_finishedCallback(nullptr),
+    m_data(nullptr),
+    m_isRunning(false)
+{}
+
+ClockedAudioSink::~ClockedAudioSink()
+{
+    /*
+    The derived classes must stop the thread in their destructor,
+    the write method is not available anymore here.
+    */
+    joinClockThread();
+}
+
+bool ClockedAudioSink::open(
+    int numChannels,
+    size_t sampleRate,
+    StreamCallback streamCallback,
+    FinishedCallback finishedCallback,
+    void* data)
+{
+    joinClockThread();
+
+    if (numChannels <= 0 || sampleRate == 0)
+    {
+        m_lastError = "invalid stream informations";
+        return false;
+    }
+
+    m_numChannels = numChannels;
+    m_sampleRate = sampleRate;
+    m_streamCallback = streamCallback;
+    m_finishedCallback = finishedCallback;
+    m_data = data;
+    m_buffer.assign(m_framesPerBuffer * numChannels, 0.0f);
+
+    return openOutput(numChannels, sampleRate);
+}
+
+bool ClockedAudioSink::start()
+{
+    if (!m_streamCallback)
+    {
+        m_lastError = "stream not opened";
+        return false;
+    }
+
+    if (m_isRunning)
+        return true;
+
+    // The thread may have ended by itself at the end of the stream.
+    joinClockThread();
+
+    m_isRunning = true;
+    m_clockThread = std::thread(&ClockedAudioSink::clockLoop, this);
+    return true;
+}
+
+void ClockedAudioSink::stop()
+{
+    joinClockThread();
+}
+
+void ClockedAudioSink::joinClockThread()
+{
+    m_isRunning = false;
+    if (m_clockThread.joinable())
+        m_clockThread.join();
+}
+
+bool ClockedAudioSink::openOutput(int /*numChannels*/, size_t /*sampleRate*/)
+{
+    return true;
+}
+
+void ClockedAudioSink::flush()
+{}
+
+void ClockedAudioSink::clockLoop()
+{
+    SAL_DEBUG_STREAM_STATUS("Clocked sink started")
+
+    using namespace std::chrono;
+    const steady_clock::duration bufferDuration = m_speed > 0.0 ?
+        duration_cast<steady_clock::duration>(
+            duration<double>(m_framesPerBuffer / (m_sampleRate * m_speed))) :
+        steady_clock::duration::zero();
+    steady_clock::time_point nextBuffer = steady_clock::now();
+
+    while (m_isRunning.load())
+    {
+        unsigned long framesWritten = 0;
+        StreamResult result = m_streamCallback(
+            m_buffer.data(), m_framesPerBuffer, framesWritten, m_data);
+
+        if (framesWritten > 0)
+            write(m_buffer.data(), framesWritten);
+
+        if (result == StreamResult::COMPLETE)
+            break;
+
+        if (m_speed > 0.0)
+        {
+            nextBuffer += bufferDuration;
+            // Do not try to catch up the time lost by a slow write.
+            steady_clock::time_point now = steady_clock::now();
+            if (nextBuffer + bufferDuration < now)
+                nextBuffer = now;
+            std::this_thread::sleep_until(nextBuffer);
+        }
+        else if (result == StreamResult::BUFFERING)
+            std::this_thread::sleep_for(CLOCKED_SINK_BUFFERING_WAIT);
+    }
+
+    m_isRunning = false;
+    flush();
+    if (m_finishedCallback)
+        m_finishedCallback(m_data);
+
+    SAL_DEBUG_STREAM_STATUS("Clocked sink stopped")
+}
+}
@@ -0,0 +1,84 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_CLOCKEDAUDIOSINK_H_
+#define SIMPLE_AUDIO_LIBRARY_CLOCKEDAUDIOSINK_H_
+
+#include "AudioSink.h"
+#include <thread>
+#include <atomic>
+#include <vector>
+
+namespace SAL
+{
+/*
+Sink without audio device. A thread is calling the stream
+callback at the pace of an internal clock and hand the audio
+to the write method of the derived class.
+
+The clock run *speed times faster than real time, with a speed
+of 0 the stream callback is called as fast as possible. The
+callback is asked *framesPerBuffer frames at once, 0 for the
+default size. Only
+the frames of audio are written, the silence of buffering and
+the padding at the end of the stream are discarded, this way the
+output is the same whatever the speed and the decoding time.
+*/
+class ClockedAudioSink : public AudioSink
+{
+    ClockedAudioSink(const ClockedAudioSink& other) = delete;
+public:
+    ClockedAudioSink(double speed, size_t framesPerBuffer);
+    virtual ~ClockedAudioSink();
+
+    virtual bool open(
+        int numChannels,
+        size_t sampleRate,
+        StreamCallback streamCallback,
+        FinishedCallback finishedCallback,
+        void* data) override;
+    virtual bool start() override;
+    virtual void stop() override;
+
+protected:
+    /*
+    Prepare the output for a stream of *numChannels at *sampleRate.
+    */
+    virtual bool openOutput(int numChannels, size_t sampleRate);
+
+    /*
+    Write *frames frames of interleaved samples.
+    Called from the clock thread.
+    */
+    virtual void write(const float* samples, unsigned long frames) = 0;
+
+    /*
+    Called from the clock thread when the sink become inactive.
+    */
+    virtual void flush();
+
+private:
+    /*
+    Call the stream callback until the end of the
+    stream or until the sink is stopped.
+    */
+    void clockLoop();
+
+    /*
+    Stop the clock thread and wait for it.
+    */
+    void joinClockThread();
+
+    double m_speed;
+    size_t m_framesPerBuffer;
+    int m_numChannels;
+    size_t m_sampleRate;
+
+    StreamCallback m_streamCallback;
+    FinishedCallback m_finishedCallback;
+    void* m_data;
+
+    std::vector<float> m_buffer;
+    std::thread m_clockThread;
+    std::atomic<bool> m_isRunning;
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_CLOCKEDAUDIOSINK_H_
@@ -0,0 +1,174 @@
+#include "Decoder.h"
+#include "AbstractAudioFile.h"
+#include "FormatProbe.h"
+#include "DebugLog.h"
+#include <algorithm>
+
+// Number of frames decoded at once before splitting them into planes.
+#define DECODER_PLANAR_FRAMES 4096
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "Decoder";
+
+namespace SAL
+{
+Decoder::Decoder()
+{}
+
+Decoder::Decoder(const std::string& filePath)
+{
+    open(filePath);
+}
+
+Decoder::~Decoder()
+{}
+
+bool Decoder::open(const std::string& filePath)
+{
+    SAL_DEBUG_OPEN_FILE("Opening the file " + filePath + " for decoding")
+
+    close();
+
+    std::unique_ptr<AbstractAudioFile> file(FormatProbe::open(filePath));
+    if (!file || !file->isOpen() || file->numChannels() <= 0)
+    {
+        SAL_DEBUG_OPEN_FILE("Opening the file " + filePath + " for decoding failed")
+
+        return false;
+    }
+
+    m_file = std::move(file);
+    return true;
+}
+
+void Decoder::close()
+{
+    m_file.reset();
+}
+
+const std::string& Decoder::filePath() const
+{
+    static const std::string empty;
+    return m_file ? m_file->filePath() : empty;
+}
+
+size_t Decoder::sampleRate() const
+{
+    return m_file ? m_file->sampleRate() : 0;
+}
+
+int Decoder::numChannels() const
+{
+    return m_file ? m_file->numChannels() : 0;
+}
+
+size_t Decoder::streamSize() const
+{
+    return m_file ? m_file->streamSize() : 0;
+}
+
+size_t Decoder::position() const
+{
+    return m_file ? m_file->streamPos() : 0;
+}
+
+bool Decoder::seek(size_t frame)
+{
+    if (!m_file)
+        return false;
+    return m_file->decodeSeek(frame);
+}
+
+size_t Decoder::read(float* output, size_t frames, Layout layout)
+{
+    if (!m_file || !output || frames == 0)
+        return 0;
+
+    // Mono is the same in both layouts.
+    if (layout == Layout::INTERLEAVED || m_file->numChannels() == 1)
+        return m_file->decode(output, frames);
+
+    return readPlanar(output, frames, nullptr, frames);
+}
+
+size_t Decoder::read(float* const* planes, size_t frames)
+{
+    if (!m_file || !planes || frames == 0)
+        return 0;
+
+    if (m_file->numChannels() == 1)
+        return m_file->decode(planes[0], frames);
+
+    return readPlanar(nullptr, 0, planes, frames);
+}
+
+size_t Decoder::readRange(size_t start, size_t frames, float* output, Layout layout)
+{
+    if (!seek(start))
+        return 0;
+    return read(output, frames, layout);
+}
+
+size_t Decoder::readAll(std::vector<float>& output, Layout layout)
+{
+    if (!m_file)
+    {
+        output.clear();
+        return 0;
+    }
+
+    const size_t channels = m_file->numChannels();
+    const size_t position = m_file->streamPos();
+    const size_t frames = m_file->streamSize() > position ? m_file->streamSize() - position : 0;
+
+    // The size of the stream is known from the headers, everything is decoded at once.
+    output.resize(frames * channels);
+    size_t framesDecoded = read(output.data(), frames, layout);
+
+    // The planes are moved next to each other when the stream was shorter than expected.
+    if (layout == Layout::PLANAR && framesDecoded < frames)
+    {
+        for (size_t c = 1; c < channels; c++)
+            std::copy(
+                output.begin() + c * frames,
+                output.begin() + c * frames + framesDecoded,
+                output.begin() + c * framesDecoded);
+    }
+    output.resize(framesDecoded * channels);
+
+    return framesDecoded;
+}
+
+size_t Decoder::readPlanar(float* output, size_t stride, float* const* planes, size_t frames)
+{
+    const size_t channels = m_file->numChannels();
+    size_t chunkFrames = frames < DECODER_PLANAR_FRAMES ? frames : DECODER_PLANAR_FRAMES;
+    if (m_scratch.size() < chunkFrames * channels)
+        m_scratch.resize(chunkFrames * channels);
+
+    size_t framesDecoded = 0;
+    while (framesDecoded < frames)
+    {
+        size_t framesToDecode = frames - framesDecoded;
+        if (framesToDecode > chunkFrames)
+            framesToDecode = chunkFrames;
+
+        size_t decoded = m_file->decode(m_scratch.data(), framesToDecode);
+
+        // Split the interleaved frames into the planes.
+        for (size_t c = 0; c < channels; c++)
+        {
+            float* plane = (planes ? planes[c] : output + c * stride) + framesDecoded;
+            const float* sample = m_scratch.data() + c;
+            for (size_t i = 0; i < decoded; i++, sample += channels)
+                plane[i] = *sample;
+        }
+
+        framesDecoded += decoded;
+        if (decoded < framesToDecode)
+            break;
+    }
+
+    return framesDecoded;
+}
+}
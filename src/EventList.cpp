@@ -1,67 +1,215 @@
 #include "EventList.h"
+#include <algorithm>
 
-namespace SAL 
+// Number of nodes allocated for the pool.
+#define EVENT_POOL_SIZE 256
+
+// Longest wait of the main loop, a wake up missed while it is entering the wait is caught by this timeout.
+#define MAX_WAIT_TIME std::chrono::milliseconds(50)
+
+namespace SAL
 {
-EventList::EventList()
-{}
+EventList::EventList() :
+    m_head(&m_stub),
+    m_tail(&m_stub),
+    m_pool(new EventNode[EVENT_POOL_SIZE]),
+    m_freeHead(0),
+    m_isWaiting(false),
+    m_isWakeUpRequested(false),
+    m_lastWaitEventID(0),
+    m_processedWaitEventID(0)
+{
+    m_stub.next = nullptr;
+    m_stub.poolIndex = 0;
+    m_stub.nextFree = 0;
+
+    // Chaining every node of the pool into the free list.
+    for (uint32_t i = 0; i < EVENT_POOL_SIZE; i++)
+    {
+        m_pool[i].next = nullptr;
+        m_pool[i].poolIndex = i + 1;
+        m_pool[i].nextFree = i + 1 < EVENT_POOL_SIZE ? i + 2 : 0;
+    }
+    m_freeHead = 1;
+}
 
 EventList::~EventList()
-{}
+{
+    // Delete the nodes allocated outside the pool.
+    while (EventNode* node = popNode())
+        releaseNode(node);
+}
+
+EventList::EventNode* EventList::acquireNode()
+{
+    uint64_t freeHead = m_freeHead.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(freeHead) != 0)
+    {
+        EventNode* node = &m_pool[static_cast<uint32_t>(freeHead) - 1];
+        // The counter is incremented on each change, a stale head cannot be exchanged.
+        uint64_t newHead = ((freeHead >> 32) + 1) << 32 | node->nextFree.load(std::memory_order_relaxed);
+        if (m_freeHead.compare_exchange_weak(freeHead, newHead, std::memory_order_acquire))
+            return node;
+    }
+
+    // The pool is empty.
+    EventNode* node = new EventNode();
+    node->poolIndex = 0;
+    node->nextFree = 0;
+    return node;
+}
+
+void EventList::releaseNode(EventNode* node) noexcept
+{
+    if (node->poolIndex == 0)
+    {
+        delete node;
+        return;
+    }
+
+    // Release the content of the event (the file path of OPEN_FILE).
+    node->data.data = EventVariant();
+
+    uint64_t freeHead = m_freeHead.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do
+    {
+        node->nextFree.store(static_cast<uint32_t>(freeHead), std::memory_order_relaxed);
+        newHead = ((freeHead >> 32) + 1) << 32 | node->poolIndex;
+    } while (!m_freeHead.compare_exchange_weak(freeHead, newHead, std::memory_order_release));
+}
+
+void EventList::pushNode(EventNode* node) noexcept
+{
+    node->next.store(nullptr, std::memory_order_relaxed);
+    // The node is visible to the consumer once linked to the previous head.
+    EventNode* prev = m_head.exchange(node);
+    prev->next.store(node, std::memory_order_release);
+}
+
+EventList::EventNode* EventList::popNode() noexcept
+{
+    EventNode* tail = m_tail;
+    EventNode* next = tail->next.load(std::memory_order_acquire);
+
+    // Skip the stub node.
+    if (tail == &m_stub)
+    {
+        if (!next)
+            return nullptr;
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+
+    // A producer exchanged the head but did not link its node yet.
+    if (tail != m_head.load())
+        return nullptr;
+
+    // The tail is the last node, the stub is pushed back to unlink it.
+    pushNode(&m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+    return nullptr;
+}
+
+void EventList::push(EventType type, const EventVariant& data)
+{
+    EventNode* node = acquireNode();
+    node->data.type = type;
+    node->data.data = data;
+    pushNode(node);
+
+    notifyIfWaiting();
+}
 
 EventData EventList::get()
 {
-    if (containEvents())
+    EventNode* node = popNode();
+    if (!node)
+        return {EventType::INVALID, EventVariant()};
+
+    EventData data = std::move(node->data);
+    releaseNode(node);
+    return data;
+}
+
+size_t EventList::drain(std::vector<EventData>& events)
+{
+    size_t count = 0;
+    while (EventNode* node = popNode())
     {
-        std::scoped_lock lock(m_queueMutex);
-        EventData data = m_queue.front();
-        m_queue.erase(m_queue.begin());
-        return data;
+        events.push_back(std::move(node->data));
+        releaseNode(node);
+        count++;
     }
-    return {EventType::INVALID, EventVariant()};
+    return count;
 }
 
-int EventList::waitEvent()
+void EventList::setWaitEventProcessed(size_t id)
 {
-    std::scoped_lock lock(m_queueMutex);
-    int max = 0;
-    for (const EventData& data : m_queue)
     {
-        if (data.type == EventType::WAIT_EVENT)
-        {
-            try
-            {
-                max = std::max(
-                    std::get<int>(data.data),
-                    max);
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-        }
+        std::scoped_lock lock(m_waitEventMutex);
+        m_processedWaitEventID.store(id, std::memory_order_release);
     }
-    m_queue.push_back({EventType::WAIT_EVENT, ++max});
-    return max;
+    m_waitEventCV.notify_all();
 }
 
-bool EventList::isWaitEventIDPresent(int id) const
+size_t EventList::waitEvent()
 {
-    std::scoped_lock lock(m_queueMutex);
-    for (const EventData& data : m_queue)
+    std::scoped_lock lock(m_waitEventMutex);
+    push(EventType::WAIT_EVENT, ++m_lastWaitEventID);
+    return m_lastWaitEventID;
+}
+
+void EventList::waitUntilProcessed(size_t id)
+{
+    std::unique_lock lock(m_waitEventMutex);
+    m_waitEventCV.wait(lock, [this, id]() { return isWaitEventProcessed(id); });
+}
+
+void EventList::wakeUp()
+{
+    m_isWakeUpRequested.store(true);
+    notifyIfWaiting();
+}
+
+void EventList::notifyIfWaiting()
+{
+    /*
+    Either the main loop see the new event or the wake up request,
+    or this thread see the main loop waiting. The mutex is not locked,
+    this method is called from the stream callback: if the main loop
+    is not inside the wait yet, the wake up is caught by its timeout.
+    */
+    if (m_isWaiting.load())
+        m_waitCV.notify_one();
+}
+
+void EventList::wait(std::chrono::steady_clock::duration timeout)
+{
+    auto isWokenUp = [this]() { return containEvents() || m_isWakeUpRequested.load(); };
+
+    if (timeout != std::chrono::steady_clock::duration::zero())
     {
-        if (data.type == EventType::WAIT_EVENT)
-        {
-            try
-            {
-                if (std::get<int>(data.data) == id)
-                    return true;
-            }
-            catch (const std::bad_variant_access&)
-            {
-                continue;
-            }
-        }
+        std::unique_lock lock(m_waitMutex);
+        m_isWaiting.store(true);
+
+        m_waitCV.wait_for(lock, std::min<std::chrono::steady_clock::duration>(timeout, MAX_WAIT_TIME), isWokenUp);
+
+        m_isWaiting.store(false, std::memory_order_relaxed);
     }
-    return false;
+
+    m_isWakeUpRequested.store(false, std::memory_order_relaxed);
 }
 }
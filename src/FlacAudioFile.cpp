@@ -2,7 +2,6 @@
 #include "DebugLog.h"
 #include <filesystem>
 #include <cstring>
-#include <vector>
 
 #ifdef WIN32
 #include "UTFConvertion.h"
@@ -104,7 +103,8 @@ void FlacAudioFile::metadata_callback(const FLAC__StreamMetadata* metadata)
         setBytesPerSample(metadata->data.stream_info.bits_per_sample/8);
         setSizeStream(
             metadata->data.stream_info.total_samples*numChannels()*bytesPerSample());
-        updateBuffersSize();
+        // A block may be decoded past the end of the temporary buffer.
+        updateBuffersSize(metadata->data.stream_info.max_blocksize);
         setSampleType(SampleType::INT);
     }
 
@@ -156,9 +156,8 @@ FLAC__StreamDecoderWriteStatus FlacAudioFile::write_callback(const FLAC__Frame*
         }
     }
 
-    // Temporary buffer
-    //char data[frame->header.blocksize * numChannels() * bytesPerSample()];
-    std::vector<char> data(frame->header.blocksize * numChannels() * bytesPerSample());
+    // Buffer owned by the file, allocated once for the biggest block.
+    char* data = rawBuffer(frame->header.blocksize * numChannels() * bytesPerSample());
     // Hold the position of the buffer in bytes.
     size_t dataPos = 0;
 
@@ -167,13 +166,13 @@ FLAC__StreamDecoderWriteStatus FlacAudioFile::write_callback(const FLAC__Frame*
     {
         for (int j = 0; j < numChannels(); j++)
         {
-            memcpy(data.data()+dataPos, &buffer[j][i], bytesPerSample());
+            memcpy(data+dataPos, &buffer[j][i], bytesPerSample());
             dataPos += bytesPerSample();
         }
     }
 
     // Copy the buffer (data) into the temporary buffer of (AbstractAudioFile).
-    insertDataInfoTmpBuffer(data.data(), dataPos);
+    insertDataInfoTmpBuffer(data, dataPos);
     incrementReadPos(dataPos);
 
     SAL_DEBUG_READ_FILE("Read data from file done")
@@ -196,8 +195,10 @@ void FlacAudioFile::readDataFromFile()
 
     SAL_DEBUG_READ_FILE("Reading a frame")
 
-    // Reading a block from the flac file.
-    long long counter = 0;
+    // Reading blocks from the flac file until the temporary buffer is filled.
+    // The data may go directly into the ring buffer, so the size is based on the read position.
+    const size_t startReadPos = readPos();
+    const size_t readSize = readSizeFromFile();
     while (true)
     {
         if (!process_single())
@@ -210,7 +211,7 @@ void FlacAudioFile::readDataFromFile()
         if (get_state() == FLAC__STREAM_DECODER_END_OF_STREAM)
             endFile(true);
 
-        if ((!isEndFile() && getTmpBufferSizeWriten() > (getTmpBufferSize() / 2)) || isEndFile())
+        if (isEndFile() || readPos() - startReadPos >= readSize)
         {
             break;
         }
@@ -0,0 +1,257 @@
+#include "FormatProbe.h"
+#include "AbstractAudioFile.h"
+#include "DebugLog.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#ifdef WIN32
+#include "UTFConvertion.h"
+#endif
+
+#ifdef USE_WAVE
+#include "WaveAudioFile.h"
+#endif
+#ifdef USE_FLAC
+#include "FlacAudioFile.h"
+#endif
+#ifdef USE_LIBSNDFILE
+#include "SndAudioFile.h"
+#endif
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "FormatProbe";
+
+namespace SAL
+{
+namespace
+{
+// Compare the magic bytes at *offset of the header.
+bool hasMagic(const char* header, size_t size, size_t offset, const char* magic)
+{
+    size_t magicSize = strlen(magic);
+    return size >= offset + magicSize && memcmp(header + offset, magic, magicSize) == 0;
+}
+
+#if defined(USE_WAVE) || defined(USE_LIBSNDFILE)
+// RIFF, RF64 and BW64 WAVE files.
+bool isWave(const char* header, size_t size)
+{
+    return (hasMagic(header, size, 0, "RIFF") ||
+        hasMagic(header, size, 0, "RF64") ||
+        hasMagic(header, size, 0, "BW64")) &&
+        hasMagic(header, size, 8, "WAVE");
+}
+#endif
+
+#if defined(USE_FLAC) || defined(USE_LIBSNDFILE)
+bool isFlac(const char* header, size_t size)
+{
+    return hasMagic(header, size, 0, "fLaC");
+}
+#endif
+
+#ifdef USE_LIBSNDFILE
+// The formats read by libsndfile.
+bool isSndFile(const char* header, size_t size)
+{
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(header);
+    return isWave(header, size) ||
+        isFlac(header, size) ||
+        hasMagic(header, size, 0, "OggS") ||
+        hasMagic(header, size, 0, "FORM") || // AIFF, AIFC, 8SVX
+        hasMagic(header, size, 0, ".snd") || // AU big endian
+        hasMagic(header, size, 0, "dns.") || // AU little endian
+        hasMagic(header, size, 0, "caff") || // CAF
+        hasMagic(header, size, 0, "riff") || // Wave64
+        hasMagic(header, size, 0, "Creative Voice File") ||
+        // MPEG audio frame sync.
+        (size >= 2 && b[0] == 0xFF && (b[1] & 0xE0) == 0xE0);
+}
+#endif
+
+// Size of an ID3v2 tag placed before the audio data, 0 if there is none.
+size_t id3TagSize(const char* header, size_t size)
+{
+    if (!hasMagic(header, size, 0, "ID3") || size < 10)
+        return 0;
+
+    // The size is a 28 bits "syncsafe" integer, the header and the footer are not included.
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(header);
+    size_t tagSize = (b[6] & 0x7F) << 21 | (b[7] & 0x7F) << 14 | (b[8] & 0x7F) << 7 | (b[9] & 0x7F);
+    size_t footerSize = (b[5] & 0x10) ? 10 : 0;
+    return 10 + tagSize + footerSize;
+}
+}
+
+const std::vector<FormatProbe::Probe>& FormatProbe::probes()
+{
+    static const std::vector<Probe> probesList = {
+#ifdef USE_WAVE
+        {FileType::WAVE, isWave, WaveAudioFile::isReadable},
+#endif
+#ifdef USE_FLAC
+        {FileType::FLAC, isFlac, nullptr},
+#endif
+#ifdef USE_LIBSNDFILE
+        {FileType::SNDFILE, isSndFile, nullptr},
+#endif
+    };
+    return probesList;
+}
+
+FileType FormatProbe::match(const char* header, size_t size, std::istream& stream, bool isTagged)
+{
+    const std::streampos headerPos = stream.tellg();
+    for (const Probe& probe : probes())
+    {
+        // The WAVE reader read the RIFF header at the start of the file, a tagged file is left to the other backends.
+        if (isTagged && probe.type == FileType::WAVE)
+            continue;
+        if (!probe.match(header, size))
+            continue;
+        if (!probe.check)
+            return probe.type;
+
+        stream.clear();
+        stream.seekg(headerPos);
+        if (probe.check(stream))
+            return probe.type;
+    }
+    return FileType::UNKNOWN_FILE;
+}
+
+FileType FormatProbe::probe(std::istream& stream)
+{
+    char header[HEADER_SIZE];
+    stream.read(header, HEADER_SIZE);
+    size_t size = stream.gcount();
+
+    // The ID3 tag is skipped, the audio data is after it.
+    size_t tagSize = id3TagSize(header, size);
+    if (tagSize > 0)
+    {
+        stream.clear();
+        stream.seekg(tagSize);
+        stream.read(header, HEADER_SIZE);
+        size = stream.gcount();
+    }
+
+    stream.clear();
+    stream.seekg(tagSize);
+    FileType type = match(header, size, stream, tagSize > 0);
+
+    stream.clear();
+    stream.seekg(0);
+
+    return type;
+}
+
+FileType FormatProbe::probe(const std::string& filePath)
+{
+    SAL_DEBUG_OPEN_FILE("Probing the format of the file " + filePath)
+
+#ifdef WIN32
+    std::ifstream file(UTFConvertion::toWString(filePath), std::fstream::binary);
+#else
+    std::ifstream file(filePath, std::fstream::binary);
+#endif
+    if (!file.is_open())
+        return FileType::UNKNOWN_FILE;
+
+    FileType type = probe(file);
+    if (type == FileType::UNKNOWN_FILE && isReadableBySndFile(filePath))
+        type = FileType::SNDFILE;
+    return type;
+}
+
+AbstractAudioFile* FormatProbe::open(const std::string& filePath)
+{
+    SAL_DEBUG_OPEN_FILE("Probing and opening the file " + filePath)
+
+    // The file is mapped if possible, otherwise it is read with a file stream.
+    MappedFile mappedFile;
+    std::ifstream file;
+    FileType type = UNKNOWN_FILE;
+    if (mappedFile.map(filePath))
+    {
+        MemoryStreamBuffer mappedBuffer(mappedFile.data(), mappedFile.size());
+        std::istream mappedStream(&mappedBuffer);
+        type = probe(mappedStream);
+    }
+    else
+    {
+#ifdef WIN32
+        file.open(UTFConvertion::toWString(filePath), std::fstream::binary);
+#else
+        file.open(filePath, std::fstream::binary);
+#endif
+        if (!file.is_open())
+            return nullptr;
+
+        type = probe(file);
+    }
+    std::unique_ptr<AbstractAudioFile> audioFile;
+
+    switch (type)
+    {
+#ifdef USE_WAVE
+    case FileType::WAVE:
+    {
+        if (mappedFile.isMapped())
+            audioFile.reset(new WaveAudioFile(filePath, std::move(mappedFile)));
+        else
+            audioFile.reset(new WaveAudioFile(filePath, std::move(file)));
+    } break;
+#endif
+
+#ifdef USE_FLAC
+    case FileType::FLAC:
+    {
+        mappedFile.unmap();
+        file.close();
+        audioFile.reset(new FlacAudioFile(filePath));
+    } break;
+#endif
+
+    default:
+    {} break;
+    }
+
+    // Files not recognized or not supported by the built-in backends (compressed WAVE, ...) are given to libsndfile.
+#ifdef USE_LIBSNDFILE
+    if (!audioFile || !audioFile->isOpen())
+    {
+        mappedFile.unmap();
+        file.close();
+        audioFile.reset(new SndAudioFile(filePath));
+    }
+#endif
+
+    if (!audioFile || !audioFile->isOpen())
+    {
+        SAL_DEBUG_OPEN_FILE("No backend can open the file " + filePath)
+
+        return nullptr;
+    }
+
+    return audioFile.release();
+}
+
+bool FormatProbe::isReadableBySndFile(const std::string& filePath)
+{
+#ifdef USE_LIBSNDFILE
+    // Only the headers are read.
+#ifdef WIN32
+    SndfileHandle file(UTFConvertion::toWString(filePath).c_str());
+#else
+    SndfileHandle file(filePath.c_str());
+#endif
+    return file && file.frames() > 0;
+#else
+    (void)filePath;
+    return false;
+#endif
+}
+}
@@ -0,0 +1,94 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_FORMATPROBE_H_
+#define SIMPLE_AUDIO_LIBRARY_FORMATPROBE_H_
+
+#include "Common.h"
+#include <cstddef>
+#include <string>
+#include <istream>
+#include <vector>
+
+namespace SAL
+{
+class AbstractAudioFile;
+
+/*
+Detect the format of an audio file from the magic bytes at
+the start of the file, without constructing any decoder.
+
+The probes are registered in order of preference: the built-in
+WAVE reader and the FLAC++ backend are chosen over libsndfile
+when they are compiled. The WAVE probe also reads the fmt chunk,
+the WAVE files the built-in reader cannot decode (ADPCM, mu-law,
+...) are left to libsndfile. When libsndfile is used and no magic
+bytes match, libsndfile is asked to read the headers. An ID3 tag
+before the audio data is skipped, except for the WAVE reader which
+need the RIFF header at the start of the file.
+*/
+class SAL_EXPORT_DLL FormatProbe
+{
+public:
+    /*
+    Number of bytes read at the start of the file.
+    */
+    static constexpr size_t HEADER_SIZE = 12;
+
+    /*
+    Return true if the first *size bytes of a file
+    (at most HEADER_SIZE) match a format.
+    */
+    typedef bool (*Matcher)(const char* header, size_t size);
+
+    /*
+    Return true if the backend can decode the file read by *stream,
+    once the magic bytes matched. The stream is at the start of the header.
+    */
+    typedef bool (*Checker)(std::istream& stream);
+
+    struct Probe
+    {
+        FileType type;
+        Matcher match;
+        // nullptr if the magic bytes are enough.
+        Checker check;
+    };
+
+    /*
+    Return the type of the file *filePath,
+    or UNKNOWN_FILE if no backend can read it.
+    */
+    static FileType probe(const std::string& filePath);
+
+    /*
+    Return the type of the file read by *stream.
+    The stream is moved back to the start of the file.
+    */
+    static FileType probe(std::istream& stream);
+
+    /*
+    Probe the file *filePath and open it with the matching backend.
+    The file mapped or opened by the probe is handed to the
+    WAVE reader, it is not opened twice. Return nullptr if the file cannot be opened.
+    */
+    static AbstractAudioFile* open(const std::string& filePath);
+
+private:
+    /*
+    List of the probes of the compiled backends.
+    */
+    static const std::vector<Probe>& probes();
+
+    /*
+    Return the type of the first probe matching *header
+    and accepting the file read by *stream. *isTagged is
+    true if the header is after an ID3 tag.
+    */
+    static FileType match(const char* header, size_t size, std::istream& stream, bool isTagged);
+
+    /*
+    Ask libsndfile if it can read the file *filePath.
+    */
+    static bool isReadableBySndFile(const std::string& filePath);
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_FORMATPROBE_H_
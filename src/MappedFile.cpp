@@ -0,0 +1,150 @@
+#include "MappedFile.h"
+#include "DebugLog.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SAL_MAPPED_FILE
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "MappedFile";
+
+namespace SAL
+{
+MappedFile::MappedFile() :
+    m_data(nullptr),
+    m_size(0)
+{}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    m_data(other.m_data),
+    m_size(other.m_size)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        unmap();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+bool MappedFile::map(const std::string& filePath)
+{
+    unmap();
+
+#ifdef SAL_MAPPED_FILE
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    // Only regular files can be mapped, an empty file cannot.
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0 || !S_ISREG(fileInfo.st_mode) || fileInfo.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = fileInfo.st_size;
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping is keeping the file alive.
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        SAL_DEBUG_OPEN_FILE("Mapping the file failed")
+
+        return false;
+    }
+
+    m_data = static_cast<const char*>(data);
+    m_size = size;
+    return true;
+#else
+    (void)filePath;
+    return false;
+#endif
+}
+
+void MappedFile::unmap()
+{
+#ifdef SAL_MAPPED_FILE
+    if (m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void MappedFile::prefetch(size_t pos, size_t size) const
+{
+#ifdef SAL_MAPPED_FILE
+    if (!m_data || size == 0 || pos >= m_size)
+        return;
+    if (size > m_size - pos)
+        size = m_size - pos;
+
+    // madvise need an address aligned on a page.
+    static const size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t alignedPos = pos / pageSize * pageSize;
+    madvise(const_cast<char*>(m_data) + alignedPos, size + (pos - alignedPos), MADV_WILLNEED);
+#else
+    (void)pos;
+    (void)size;
+#endif
+}
+
+void MappedFile::adviseSequential() const
+{
+#ifdef SAL_MAPPED_FILE
+    // The kernel can read ahead aggressively.
+    if (m_data)
+        madvise(const_cast<char*>(m_data), m_size, MADV_SEQUENTIAL);
+#endif
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size)
+{
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin + size);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+
+    off_type pos = off;
+    if (dir == std::ios_base::cur)
+        pos += gptr() - eback();
+    else if (dir == std::ios_base::end)
+        pos += egptr() - eback();
+
+    if (pos < 0 || pos > egptr() - eback())
+        return pos_type(off_type(-1));
+
+    setg(eback(), eback() + pos, egptr());
+    return pos_type(pos);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+}
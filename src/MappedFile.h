@@ -0,0 +1,90 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_MAPPEDFILE_H_
+#define SIMPLE_AUDIO_LIBRARY_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <string>
+#include <streambuf>
+
+namespace SAL
+{
+/*
+Whole file mapped read-only in memory.
+
+The file is opened once and mapped, the descriptor is closed
+and the mapping keep the file alive. Only the regular files
+can be mapped, and only on POSIX systems. The mapping can be
+moved, this way the format probe hand it to the WAVE reader.
+*/
+class MappedFile
+{
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+public:
+    MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    /*
+    Map the file *filePath.
+    Return false if the file cannot be opened or mapped.
+    */
+    bool map(const std::string& filePath);
+
+    /*
+    Unmap the file from memory.
+    */
+    void unmap();
+
+    inline bool isMapped() const noexcept;
+    inline const char* data() const noexcept;
+    inline size_t size() const noexcept;
+
+    /*
+    Hint the system that *size bytes starting at *pos
+    will be needed soon.
+    */
+    void prefetch(size_t pos, size_t size) const;
+
+    /*
+    Hint the system that the file is read sequentially.
+    */
+    void adviseSequential() const;
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+/*
+Read-only stream buffer over a memory block, the headers of a
+mapped file are read with the std::istream interface.
+*/
+class MemoryStreamBuffer : public std::streambuf
+{
+    MemoryStreamBuffer(const MemoryStreamBuffer& other) = delete;
+public:
+    MemoryStreamBuffer(const char* data, size_t size);
+
+protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+};
+
+inline bool MappedFile::isMapped() const noexcept
+{
+    return m_data != nullptr;
+}
+
+inline const char* MappedFile::data() const noexcept
+{
+    return m_data;
+}
+
+inline size_t MappedFile::size() const noexcept
+{
+    return m_size;
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_MAPPEDFILE_H_
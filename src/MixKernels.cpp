@@ -0,0 +1,164 @@
+#include "MixKernels.h"
+#include "SampleConverter.h"
+#include <cmath>
+
+#ifdef SAL_SSE2_KERNELS
+#include <emmintrin.h>
+#endif
+#ifdef SAL_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+namespace SAL
+{
+namespace MixKernels
+{
+namespace
+{
+void scalarCrossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+        output[i] = output[i] * outputGains[i] + input[i] * inputGains[i];
+}
+
+void scalarMix(float* output, const float* input, const float* gains, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++)
+        output[i] += input[i] * gains[i];
+}
+
+#ifdef SAL_SSE2_KERNELS
+void sse2Crossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128 out = _mm_mul_ps(_mm_loadu_ps(output + i), _mm_loadu_ps(outputGains + i));
+        __m128 in = _mm_mul_ps(_mm_loadu_ps(input + i), _mm_loadu_ps(inputGains + i));
+        _mm_storeu_ps(output + i, _mm_add_ps(out, in));
+    }
+    scalarCrossfade(output + i, input + i, outputGains + i, inputGains + i, samples - i);
+}
+
+void sse2Mix(float* output, const float* input, const float* gains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128 in = _mm_mul_ps(_mm_loadu_ps(input + i), _mm_loadu_ps(gains + i));
+        _mm_storeu_ps(output + i, _mm_add_ps(_mm_loadu_ps(output + i), in));
+    }
+    scalarMix(output + i, input + i, gains + i, samples - i);
+}
+#endif
+
+#ifdef SAL_NEON_KERNELS
+void neonCrossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+    {
+        float32x4_t out = vmulq_f32(vld1q_f32(output + i), vld1q_f32(outputGains + i));
+        vst1q_f32(output + i, vfmaq_f32(out, vld1q_f32(input + i), vld1q_f32(inputGains + i)));
+    }
+    scalarCrossfade(output + i, input + i, outputGains + i, inputGains + i, samples - i);
+}
+
+void neonMix(float* output, const float* input, const float* gains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32(output + i, vfmaq_f32(vld1q_f32(output + i), vld1q_f32(input + i), vld1q_f32(gains + i)));
+    scalarMix(output + i, input + i, gains + i, samples - i);
+}
+#endif
+
+CrossfadeKernel bestCrossfade() noexcept
+{
+#ifdef USE_AVX2_KERNELS
+    if (SampleConverter::isAvailable(SampleConverter::Instructions::AVX2))
+        return avx2Crossfade;
+#endif
+#ifdef SAL_NEON_KERNELS
+    return neonCrossfade;
+#elif defined(SAL_SSE2_KERNELS)
+    return sse2Crossfade;
+#else
+    return scalarCrossfade;
+#endif
+}
+
+MixKernel bestMix() noexcept
+{
+#ifdef USE_AVX2_KERNELS
+    if (SampleConverter::isAvailable(SampleConverter::Instructions::AVX2))
+        return avx2Mix;
+#endif
+#ifdef SAL_NEON_KERNELS
+    return neonMix;
+#elif defined(SAL_SSE2_KERNELS)
+    return sse2Mix;
+#else
+    return scalarMix;
+#endif
+}
+
+// Chosen when the library is loaded.
+const CrossfadeKernel crossfadeKernel = bestCrossfade();
+const MixKernel mixKernel = bestMix();
+}
+
+void crossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples) noexcept
+{
+    crossfadeKernel(output, input, outputGains, inputGains, samples);
+}
+
+void mix(float* output, const float* input, const float* gains, size_t samples) noexcept
+{
+    mixKernel(output, input, gains, samples);
+}
+
+void crossfadeGains(CrossfadeCurve curve, size_t position, size_t length,
+    float* outputGains, float* inputGains, size_t frames, int channels) noexcept
+{
+    const float HALF_PI = 1.57079632679489661923f;
+
+    for (size_t i = 0; i < frames; i++, position++)
+    {
+        const float t = position < length ? (float)position / length : 1.0f;
+        float outputGain;
+        float inputGain;
+        switch (curve)
+        {
+        case CrossfadeCurve::LINEAR:
+            outputGain = 1.0f - t;
+            inputGain = t;
+            break;
+        case CrossfadeCurve::S_CURVE:
+        {
+            // Smoothstep, the gains change slowly at the start and at the end.
+            const float s = t * t * (3.0f - 2.0f * t);
+            outputGain = 1.0f - s;
+            inputGain = s;
+        } break;
+        case CrossfadeCurve::EQUAL_POWER:
+        default:
+            // The sum of the power of the two streams stay the same.
+            outputGain = std::cos(t * HALF_PI);
+            inputGain = std::sin(t * HALF_PI);
+            break;
+        }
+
+        for (int c = 0; c < channels; c++)
+        {
+            *outputGains++ = outputGain;
+            *inputGains++ = inputGain;
+        }
+    }
+}
+}
+}
@@ -0,0 +1,54 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_MIXKERNELS_H_
+#define SIMPLE_AUDIO_LIBRARY_MIXKERNELS_H_
+
+#include "Common.h"
+#include <cstddef>
+
+namespace SAL
+{
+/*
+Kernels mixing 32 bits floating point streams.
+
+Each kernel have a scalar implementation and vectorized implementations
+(SSE2, AVX2 and NEON), the fastest instructions set available on the
+CPU is chosen when the library is loaded, never in the stream callback.
+*/
+namespace MixKernels
+{
+typedef void (*CrossfadeKernel)(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples);
+typedef void (*MixKernel)(float* output, const float* input, const float* gains, size_t samples);
+
+/*
+Add *samples samples of *input into *output:
+output[i] = output[i] + input[i] * gains[i]
+*/
+void mix(float* output, const float* input, const float* gains, size_t samples) noexcept;
+
+/*
+Mix *samples samples of *input into *output:
+output[i] = output[i] * outputGains[i] + input[i] * inputGains[i]
+*/
+void crossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples) noexcept;
+
+/*
+Fill *frames frames of gains of the curve with *channels samples per frame.
+The fade position of the first frame is *position out of *length frames,
+the positions past the end have the gains of the end of the fade.
+*/
+void crossfadeGains(CrossfadeCurve curve, size_t position, size_t length,
+    float* outputGains, float* inputGains, size_t frames, int channels) noexcept;
+
+#ifdef USE_AVX2_KERNELS
+/*
+AVX2 kernels, defined in the translation unit compiled with the AVX2 instructions set.
+*/
+void avx2Crossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples);
+void avx2Mix(float* output, const float* input, const float* gains, size_t samples);
+#endif
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_MIXKERNELS_H_
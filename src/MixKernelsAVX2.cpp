@@ -0,0 +1,39 @@
+#include "MixKernels.h"
+#include <immintrin.h>
+
+/*
+This translation unit is compiled with the AVX2 instructions set enabled,
+its kernels are only called after checking the CPU support them.
+*/
+
+namespace SAL
+{
+namespace MixKernels
+{
+void avx2Crossfade(float* output, const float* input,
+    const float* outputGains, const float* inputGains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256 out = _mm256_mul_ps(_mm256_loadu_ps(output + i), _mm256_loadu_ps(outputGains + i));
+        __m256 in = _mm256_mul_ps(_mm256_loadu_ps(input + i), _mm256_loadu_ps(inputGains + i));
+        _mm256_storeu_ps(output + i, _mm256_add_ps(out, in));
+    }
+    for (; i < samples; i++)
+        output[i] = output[i] * outputGains[i] + input[i] * inputGains[i];
+}
+
+void avx2Mix(float* output, const float* input, const float* gains, size_t samples)
+{
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256 in = _mm256_mul_ps(_mm256_loadu_ps(input + i), _mm256_loadu_ps(gains + i));
+        _mm256_storeu_ps(output + i, _mm256_add_ps(_mm256_loadu_ps(output + i), in));
+    }
+    for (; i < samples; i++)
+        output[i] += input[i] * gains[i];
+}
+}
+}
@@ -0,0 +1,429 @@
+#include "Mixer.h"
+#include "AbstractAudioFile.h"
+#include "PortAudioRAII.h"
+#include "FormatProbe.h"
+#include "MixKernels.h"
+#include "DebugLog.h"
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <portaudio.h>
+
+// Number of frames read from a voice and mixed at once.
+#define MIXER_BLOCK_FRAMES 256
+
+// Maximum time the refill thread wait between two reads of the files.
+#define MIXER_REFILL_INTERVAL std::chrono::milliseconds(10)
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "Mixer";
+
+namespace SAL
+{
+namespace
+{
+/*
+Gain of each channel of a voice: the gain of the voice and the master gain,
+and the balance of the pan on the two first channels.
+*/
+void voiceGains(float gain, float pan, int numChannels, float* gains)
+{
+    pan = std::clamp(pan, -1.0f, 1.0f);
+    for (int c = 0; c < numChannels; c++)
+        gains[c] = gain;
+    if (numChannels >= 2)
+    {
+        gains[0] *= std::min(1.0f, 1.0f - pan);
+        gains[1] *= std::min(1.0f, 1.0f + pan);
+    }
+}
+}
+
+Mixer::Mixer() :
+    m_isOpen(false),
+    m_sampleRate(0),
+    m_numChannels(0),
+    m_masterGain(1.0f),
+    m_nextVoiceID(0),
+    m_isRefillRunning(false),
+    m_isRefillRequested(false)
+{}
+
+Mixer::~Mixer()
+{
+    close();
+}
+
+bool Mixer::open(size_t sampleRate, int numChannels, const AudioSinkConfig& sink)
+{
+    SAL_DEBUG("Opening the mixer stream")
+
+    close();
+
+    if (sampleRate == 0 || numChannels <= 0)
+    {
+        setError("Invalid stream format");
+        return false;
+    }
+
+    int hostApiType = paInDevelopment;
+    if (sink.type == AudioSinkType::PORTAUDIO)
+    {
+        m_pa = std::unique_ptr<PortAudioRAII>(new PortAudioRAII());
+        if (!m_pa->isInit())
+        {
+            setError("Failed to initialize PortAudio");
+            m_pa.reset();
+            return false;
+        }
+        const PaHostApiInfo* hostApiInfo = Pa_GetHostApiInfo(Pa_GetDefaultHostApi());
+        if (!hostApiInfo)
+        {
+            setError("No PortAudio host API available");
+            m_pa.reset();
+            return false;
+        }
+        hostApiType = hostApiInfo->type;
+    }
+
+    m_sampleRate = sampleRate;
+    m_numChannels = numChannels;
+
+    // The stream callback cannot allocate, its buffers are allocated with the stream.
+    m_mixBuffer.assign(MIXER_BLOCK_FRAMES * numChannels, 0.0f);
+    m_gainBuffer.assign(MIXER_BLOCK_FRAMES * numChannels, 0.0f);
+
+    std::unique_ptr<AudioSink> audioSink(AudioSink::create(sink, hostApiType));
+    if (!audioSink->open(numChannels, sampleRate, staticStreamCallback, nullptr, this))
+    {
+        setError("Failed to open the sink: " + audioSink->lastError());
+        m_pa.reset();
+        return false;
+    }
+    m_sink = std::move(audioSink);
+
+    m_isRefillRunning = true;
+    m_refillThread = std::thread(&Mixer::refillLoop, this);
+    m_isOpen = true;
+
+    SAL_DEBUG("Opening the mixer stream done")
+
+    return true;
+}
+
+void Mixer::close()
+{
+    if (!m_isOpen)
+        return;
+
+    SAL_DEBUG("Closing the mixer stream")
+
+    m_sink->stop();
+    m_sink.reset();
+
+    {
+        std::scoped_lock lock(m_refillMutex);
+        m_isRefillRunning = false;
+    }
+    m_refillCV.notify_one();
+    if (m_refillThread.joinable())
+        m_refillThread.join();
+
+    {
+        std::scoped_lock lock(m_voicesMutex);
+        m_activeVoices.publish(std::vector<Voice*>());
+        m_voices.clear();
+    }
+
+    m_pa.reset();
+    m_isOpen = false;
+
+    SAL_DEBUG("Closing the mixer stream done")
+}
+
+bool Mixer::start()
+{
+    if (!m_isOpen)
+        return false;
+
+    if (!m_sink->start())
+    {
+        setError("Failed to start the sink: " + m_sink->lastError());
+        return false;
+    }
+    return true;
+}
+
+void Mixer::stop()
+{
+    if (m_isOpen)
+        m_sink->stop();
+}
+
+int Mixer::addVoice(const std::string& filePath, float gain, float pan, bool isLooping)
+{
+    SAL_DEBUG("Adding voice: " + filePath)
+
+    if (!m_isOpen)
+    {
+        setError("The mixer is not open");
+        return -1;
+    }
+
+    std::unique_ptr<AbstractAudioFile> file(FormatProbe::open(filePath));
+    if (!file || !file->isOpen())
+    {
+        setError("Cannot open the file: " + filePath);
+        return -1;
+    }
+
+    // The files are converted to the format of the stream, the first frames are read before publishing the voice.
+    file->setBufferingPolicy(BufferingPolicy());
+    file->setOutputFormat(m_numChannels, m_sampleRate);
+    file->readFromFile();
+    file->flush();
+
+    std::shared_ptr<Voice> voice = std::make_shared<Voice>();
+    voice->file = std::move(file);
+    voice->gain = gain;
+    voice->pan = pan;
+    voice->isLooping = isLooping;
+    voice->isSuspended = false;
+    voice->isDrained = false;
+    voice->appliedGains.assign(m_numChannels, 0.0f);
+    voiceGains(gain * m_masterGain, pan, m_numChannels, voice->appliedGains.data());
+
+    std::scoped_lock lock(m_voicesMutex);
+    voice->id = m_nextVoiceID++;
+    const int id = voice->id;
+    m_voices.push_back(std::move(voice));
+    publishVoices();
+    return id;
+}
+
+void Mixer::removeVoice(int id)
+{
+    std::shared_ptr<Voice> removed;
+
+    std::scoped_lock lock(m_voicesMutex);
+    auto it = std::find_if(m_voices.begin(), m_voices.end(),
+        [id](const std::shared_ptr<Voice>& voice) { return voice->id == id; });
+    if (it == m_voices.end())
+        return;
+
+    // The voice is deleted once the stream callback cannot use it anymore.
+    removed = std::move(*it);
+    m_voices.erase(it);
+    publishVoices();
+}
+
+void Mixer::setVoiceGain(int id, float gain)
+{
+    std::scoped_lock lock(m_voicesMutex);
+    for (std::shared_ptr<Voice>& voice : m_voices)
+    {
+        if (voice->id == id)
+            voice->gain = gain;
+    }
+}
+
+void Mixer::setVoicePan(int id, float pan)
+{
+    std::scoped_lock lock(m_voicesMutex);
+    for (std::shared_ptr<Voice>& voice : m_voices)
+    {
+        if (voice->id == id)
+            voice->pan = pan;
+    }
+}
+
+bool Mixer::isVoicePlaying(int id)
+{
+    std::scoped_lock lock(m_voicesMutex);
+    return std::any_of(m_voices.cbegin(), m_voices.cend(),
+        [id](const std::shared_ptr<Voice>& voice) { return voice->id == id; });
+}
+
+size_t Mixer::voiceCount()
+{
+    std::scoped_lock lock(m_voicesMutex);
+    return m_voices.size();
+}
+
+std::string Mixer::lastError()
+{
+    std::scoped_lock lock(m_errorMutex);
+    return m_lastError;
+}
+
+void Mixer::setError(const std::string& error)
+{
+    SAL_DEBUG("Mixer error: " + error)
+
+    std::scoped_lock lock(m_errorMutex);
+    m_lastError = error;
+}
+
+void Mixer::publishVoices()
+{
+    std::vector<Voice*> voices;
+    voices.reserve(m_voices.size());
+    for (std::shared_ptr<Voice>& voice : m_voices)
+        voices.push_back(voice.get());
+    m_activeVoices.publish(std::move(voices));
+}
+
+AudioSink::StreamResult Mixer::staticStreamCallback(
+    void* output,
+    unsigned long frames,
+    unsigned long& framesWritten,
+    void* data)
+{
+    Mixer* pMixer = static_cast<Mixer*>(data);
+    framesWritten = frames;
+    return std::invoke(&Mixer::streamCallback, pMixer, static_cast<float*>(output), frames);
+}
+
+AudioSink::StreamResult Mixer::streamCallback(float* output, unsigned long frames)
+{
+    memset(output, 0, frames * m_numChannels * sizeof(float));
+
+    bool isWakeUpNeeded = false;
+
+    // The voices stay valid until the end of the read section.
+    ActiveList<Voice*>::ReadSection section(m_activeVoices);
+    for (Voice* voice : section.items())
+    {
+        if (voice->isSuspended)
+            continue;
+
+        AbstractAudioFile* file = voice->file.get();
+        if (file->isLowWatermarkCrossed())
+            isWakeUpNeeded = true;
+
+        for (size_t position = 0; position < frames; position += MIXER_BLOCK_FRAMES)
+        {
+            size_t blockFrames = std::min<size_t>(MIXER_BLOCK_FRAMES, frames - position);
+            size_t framesRead = file->readOutput(reinterpret_cast<char*>(m_mixBuffer.data()), blockFrames);
+            if (framesRead > 0)
+                mixVoice(*voice, output + position * m_numChannels, framesRead);
+
+            // Not enough frames buffered or end of the file, the rest of the voice is silence.
+            if (framesRead < blockFrames)
+            {
+                // The last frames of the file and of the resampler are played.
+                if (file->isEnded() && file->remainingOutputFrames() == 0)
+                    voice->isDrained = true;
+                isWakeUpNeeded = true;
+                break;
+            }
+        }
+    }
+
+    if (isWakeUpNeeded)
+    {
+        // A wake up missed while the refill thread is not waiting is caught by its timeout.
+        m_isRefillRequested = true;
+        m_refillCV.notify_one();
+    }
+
+    return AudioSink::StreamResult::CONTINUE;
+}
+
+void Mixer::mixVoice(Voice& voice, float* output, size_t frames)
+{
+    const int numChannels = m_numChannels;
+    float targetGains[2];
+    float* applied = voice.appliedGains.data();
+
+    // The gains of the first two channels may be panned, the other channels have the same gain.
+    const float gain = voice.gain * m_masterGain;
+    float* gains = m_gainBuffer.data();
+    if (numChannels >= 2)
+        voiceGains(gain, voice.pan, 2, targetGains);
+    else
+        targetGains[0] = gain;
+
+    // The gains are ramped from the previous block to avoid clicks.
+    for (int c = 0; c < numChannels; c++)
+    {
+        const float target = c < 2 ? targetGains[c] : gain;
+        const float step = (target - applied[c]) / frames;
+        for (size_t i = 0; i < frames; i++)
+            gains[i * numChannels + c] = applied[c] + step * (i + 1);
+        applied[c] = target;
+    }
+
+    MixKernels::mix(output, m_mixBuffer.data(), gains, frames * numChannels);
+}
+
+void Mixer::refillLoop()
+{
+    // The voices read by this iteration, the files are read without m_voicesMutex.
+    std::vector<std::shared_ptr<Voice>> voices;
+    std::vector<std::shared_ptr<Voice>> ended;
+
+    while (m_isRefillRunning)
+    {
+        bool isRefilling = false;
+
+        {
+            std::scoped_lock lock(m_voicesMutex);
+            voices.assign(m_voices.cbegin(), m_voices.cend());
+        }
+
+        for (std::shared_ptr<Voice>& voice : voices)
+        {
+            AbstractAudioFile* file = voice->file.get();
+            // The file may be ended while the stream callback still has frames to read,
+            // the voice is only removed or rewound once the callback played them.
+            if (voice->isDrained)
+            {
+                if (!voice->isLooping)
+                {
+                    ended.push_back(voice);
+                    continue;
+                }
+
+                // The stream callback must not read the file while seeking.
+                // The voice is silent until the first frames are read again, the
+                // stream callback wakes up this thread to keep the gap short.
+                voice->isSuspended = true;
+                m_activeVoices.synchronize();
+                file->seek(0);
+                voice->isDrained = false;
+                voice->isSuspended = false;
+            }
+
+            file->readFromFile();
+            file->flush();
+            if (file->isRefilling())
+                isRefilling = true;
+        }
+
+        // The voices ended are deleted after being removed from the stream callback.
+        if (!ended.empty())
+        {
+            SAL_DEBUG("Removing " + std::to_string(ended.size()) + " voices ended")
+
+            std::scoped_lock lock(m_voicesMutex);
+            m_voices.erase(std::remove_if(m_voices.begin(), m_voices.end(),
+                [&ended](const std::shared_ptr<Voice>& voice) {
+                    return std::find(ended.cbegin(), ended.cend(), voice) != ended.cend(); }),
+                m_voices.end());
+            publishVoices();
+        }
+        ended.clear();
+        voices.clear();
+
+        // Keep reading until the ring buffers are full.
+        if (!isRefilling)
+        {
+            std::unique_lock lock(m_refillMutex);
+            m_refillCV.wait_for(lock, MIXER_REFILL_INTERVAL,
+                [this]() { return m_isRefillRequested.load() || !m_isRefillRunning.load(); });
+        }
+        m_isRefillRequested = false;
+    }
+}
+}
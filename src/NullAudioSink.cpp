@@ -0,0 +1,16 @@
+#include "NullAudioSink.h"
+
+namespace SAL
+{
+NullAudioSink::NullAudioSink(double speed, size_t framesPerBuffer) :
+    ClockedAudioSink(speed, framesPerBuffer)
+{}
+
+NullAudioSink::~NullAudioSink()
+{
+    stop();
+}
+
+void NullAudioSink::write(const float* /*samples*/, unsigned long /*frames*/)
+{}
+}
@@ -0,0 +1,23 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_NULLAUDIOSINK_H_
+#define SIMPLE_AUDIO_LIBRARY_NULLAUDIOSINK_H_
+
+#include "ClockedAudioSink.h"
+
+namespace SAL
+{
+/*
+Sink discarding the audio. Useful to run the
+player without audio device.
+*/
+class NullAudioSink : public ClockedAudioSink
+{
+public:
+    NullAudioSink(double speed, size_t framesPerBuffer);
+    virtual ~NullAudioSink();
+
+protected:
+    virtual void write(const float* samples, unsigned long frames) override;
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_NULLAUDIOSINK_H_
@@ -2,11 +2,12 @@
 #include "Common.h"
 #include "DebugLog.h"
 #include "config.h"
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <cstring>
 #include <functional>
-#include <limits>
+#include <iterator>
 #include <mutex>
 #include <portaudio.h>
 
@@ -14,30 +15,47 @@
 #include "UTFConvertion.h"
 #endif
 
-#ifdef USE_WAVE
-#include "WaveAudioFile.h"
-#endif
-#ifdef USE_FLAC
-#include "FlacAudioFile.h"
-#endif
-#ifdef USE_LIBSNDFILE
-#include "SndAudioFile.h"
-#endif
+#include "FormatProbe.h"
 #include "CallbackInterface.h"
+#include "MixKernels.h"
+#include "ThreadPool.h"
 
 // Define CLASS_NAME to have the name of the class.
 const std::string CLASS_NAME = "Player";
 
+// Number of frames mixed at once by the crossfade.
+#define CROSSFADE_BLOCK_FRAMES 256
+
 namespace SAL
 {
-int Player::_destroyStream(void* stream)
+namespace
 {
-    return Pa_CloseStream(stream);
+/*
+Duration in seconds of the audio in the ring buffer of *file,
+the files the less buffered are refilled first.
+*/
+double bufferingDuration(const AbstractAudioFile& file)
+{
+    const size_t bytesPerSecond = file.streamBytesPerFrame() * file.sampleRate();
+    return bytesPerSecond > 0 ? (double)file.bufferingSize() / bytesPerSecond : 0.0;
+}
+
+/*
+Duration in milliseconds left to play of *file.
+*/
+size_t remainingDuration(const AbstractAudioFile& file)
+{
+    const size_t sampleRate = file.sampleRate();
+    const size_t position = file.streamPos();
+    if (sampleRate == 0 || position >= file.streamSize())
+        return 0;
+    return static_cast<size_t>((uint64_t)(file.streamSize() - position) * 1000 / sampleRate);
+}
 }
 
 Player::Player() :
-    // PortAudio stream interface.
-    m_paStream(nullptr, Pa_CloseStream),
+
+    m_isStreamSuspended(false),
 
     m_backendAudio(getSystemDefaultBackendAudio()),
 
@@ -52,11 +70,17 @@ Player::Player() :
     m_isBuffering(false),
 
     // Maximum of same stream in the m_queueOpenedFile queue.
-    m_maxInStreamQueue(2),
+    m_maxInStreamQueue(BufferingPolicy().prefetchDepth),
+
+    m_isConvertingStream(false),
+    m_resamplerQuality(ResamplerQuality::MEDIUM),
+    m_crossfadeDuration(0),
+    m_crossfadeCurve(CrossfadeCurve::EQUAL_POWER),
 
     m_callbackInterface(nullptr),
 
-    m_streamPosLastCallback(std::numeric_limits<size_t>::max()),
+    m_refillTasks(0),
+    m_isRefillStopping(false),
 
     m_doNotCheckFile(false),
     m_isStopping(false)
@@ -65,7 +89,18 @@ Player::Player() :
 }
 
 Player::~Player()
-{}
+{
+    // The sink stop calling the stream callbacks before the members they are using are destroyed.
+    {
+        std::scoped_lock lock(m_sinkMutex);
+        m_sink.reset();
+    }
+
+    // The refill tasks stop after the temporary buffer they are reading.
+    std::unique_lock lock(m_refillTaskMutex);
+    m_isRefillStopping = true;
+    m_refillTaskCV.wait(lock, [this]() { return m_refillTasks == 0; });
+}
 
 void Player::open(const std::string& filePath, bool clearQueue)
 {
@@ -123,12 +158,11 @@ void Player::play()
 
     SAL_DEBUG_EVENTS("Start playing stream")
     
-    std::scoped_lock lock(m_paStreamMutex);
+    std::scoped_lock lock(m_sinkMutex);
     
-    if (m_paStream)
+    if (m_sink)
     {
-        PaError err = Pa_StartStream(m_paStream.get());
-        if (err == paNoError)
+        if (m_sink->start())
         {
             if (!m_isPlaying || m_isPaused)
                 streamPlayingCallback();
@@ -139,7 +173,7 @@ void Player::play()
 #ifndef NDEBUG
         else
         {
-            SAL_DEBUG_EVENTS(std::string("Failed to start playing stream: ") + Pa_GetErrorText(err))
+            SAL_DEBUG_EVENTS("Failed to start playing stream: " + m_sink->lastError())
         }
 #endif
 
@@ -162,12 +196,11 @@ void Player::play()
 
                 SAL_DEBUG_EVENTS("Failed to start playing stream")
             }
-            PaError err = Pa_StartStream(m_paStream.get());
-            if (err == paNoError)
+            else if (m_sink->start())
             {
                 std::scoped_lock lock(m_queueOpenedFileMutex);
                 // Notify that the stream is starting.
-                for (const std::unique_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+                for (const std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
                 {
                     if (!file->isEnded())
                     {
@@ -184,7 +217,7 @@ void Player::play()
             {
                 m_isPlaying = false;
 
-                SAL_DEBUG_EVENTS(std::string("Failed to start playing stream: ") + Pa_GetErrorText(err))
+                SAL_DEBUG_EVENTS("Failed to start playing stream: " + m_sink->lastError())
             }
         }
     }
@@ -194,10 +227,10 @@ void Player::pause()
 {
     SAL_DEBUG_EVENTS("Pausing stream")
 
-    std::scoped_lock lock(m_paStreamMutex);
+    std::scoped_lock lock(m_sinkMutex);
     m_isPaused = true;
-    if (m_paStream)
-        Pa_StopStream(m_paStream.get());
+    if (m_sink)
+        m_sink->stop();
     if (m_isPlaying == true)
         streamPausedCallback();
     m_isPlaying = false;
@@ -213,7 +246,7 @@ void Player::stop()
     bool hasAStreamPlaying = false;
     {
         std::scoped_lock lock(m_queueFilePathMutex);
-        for (std::unique_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+        for (std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
         {
             if (!file->isEnded())
             {
@@ -234,10 +267,11 @@ void Player::stop()
     streamStoppingCallback();
 
     // Stopping the stream.
-    std::scoped_lock lock(m_paStreamMutex);
+    std::scoped_lock lock(m_sinkMutex);
     // Prevent streamEndCallback to call endStreamingFile callback.
     m_isStopping = true;
-    Pa_StopStream(m_paStream.get());
+    if (m_sink)
+        m_sink->stop();
     resetStreamInfo();
     m_isStopping = false;
 
@@ -254,21 +288,30 @@ void Player::next()
         {
             std::scoped_lock lock(m_queueFilePathMutex, m_queueOpenedFileMutex);
             endStreamingFile(m_queueOpenedFile.at(0)->filePath());
+            // The file is deleted once the stream callback stopped using it.
+            std::shared_ptr<AbstractAudioFile> file = std::move(m_queueOpenedFile.at(0));
             m_queueOpenedFile.erase(m_queueOpenedFile.cbegin());
+            publishActiveFiles();
+            markRemovedRefillFiles();
             m_doNotCheckFile = false;
         }
 
         // Close the stream if there is no other stream to play or that don't have the same stream info.
         if (m_queueOpenedFile.empty())
         {
-            std::scoped_lock lock(m_paStreamMutex);
-            Pa_CloseStream(m_paStream.get());
+            std::scoped_lock lock(m_sinkMutex);
+            m_sink.reset();
+            // The sink is closed on purpose, this is not the end of the stream.
+            m_isClosingStreamTheStream = false;
         }
 
         // Creating new stream if opened file array is empty.
-        while (m_queueOpenedFile.empty() && !m_queueFilePath.empty())
         {
-            pushFile();
+            std::scoped_lock lock(m_queueFilePathMutex, m_queueOpenedFileMutex);
+            while (m_queueOpenedFile.empty() && !m_queueFilePath.empty())
+            {
+                pushFile();
+            }
         }
 
         recreateStream();
@@ -289,9 +332,15 @@ void Player::removeNotPlayedPlayback()
     m_queueFilePath.clear();
 
     if (m_queueOpenedFile.size() >= 2) {
+        // The files are deleted once the stream callback stopped using them.
+        std::vector<std::shared_ptr<AbstractAudioFile>> files(
+            std::make_move_iterator(m_queueOpenedFile.begin()+1),
+            std::make_move_iterator(m_queueOpenedFile.end()));
         m_queueOpenedFile.erase(
             m_queueOpenedFile.cbegin()+1,
             m_queueOpenedFile.cend());
+        publishActiveFiles();
+        markRemovedRefillFiles();
     }
 
     SAL_DEBUG_EVENTS("Remove all in queue playback but keep the current one done")
@@ -318,7 +367,9 @@ bool Player::_isPlaying() const
 
 bool Player::isFileReady() const
 {
-    for (const std::unique_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+    // Called from the dispatcher thread of the callback interface.
+    std::scoped_lock lock(m_queueOpenedFileMutex);
+    for (const std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
     {
         if (file->isOpen() && !file->isEnded())
             return true;
@@ -328,13 +379,13 @@ bool Player::isFileReady() const
 
 void Player::pushFile()
 {
-    if (m_queueOpenedFile.size() >= m_maxInStreamQueue ||
+    if (m_queueOpenedFile.size() >= static_cast<size_t>(m_maxInStreamQueue.load()) ||
         m_queueFilePath.size() == 0 || m_doNotCheckFile)
         return;
 
     SAL_DEBUG_LOOP_UPDATE("Preparing a file to be streamed")
 
-    std::unique_ptr<AbstractAudioFile> pAudioFile(
+    std::shared_ptr<AbstractAudioFile> pAudioFile(
         detectAndOpenFile(m_queueFilePath.at(0)));
     
     if (!pAudioFile)
@@ -346,6 +397,9 @@ void Player::pushFile()
         return;
     }
 
+    // The buffers are not allocated yet, the policy is applied before the first read.
+    pAudioFile->setBufferingPolicy(m_bufferingPolicy);
+
     if (!m_queueOpenedFile.empty())
     {
         if (!checkStreamInfo(pAudioFile.get()))
@@ -355,10 +409,15 @@ void Player::pushFile()
             m_doNotCheckFile = true;
             return;
         }
+
+        // The file is played in the same stream, converted to its format.
+        if (m_isConvertingStream)
+            pAudioFile->setOutputFormat(m_numChannels, m_sampleRate, m_resamplerQuality);
     }
 
     m_queueOpenedFile.push_back(std::move(pAudioFile));
     m_queueFilePath.erase(m_queueFilePath.begin());
+    publishActiveFiles();
 
     if (m_queueOpenedFile.size() == 1)
     {
@@ -368,43 +427,31 @@ void Player::pushFile()
     SAL_DEBUG_LOOP_UPDATE("Preparing a file to be streamed done")
 }
 
-AbstractAudioFile* Player::detectAndOpenFile(const std::string& filePath) const
+void Player::publishActiveFiles()
 {
-    SAL_DEBUG_LOOP_UPDATE("Detecting audio format type of a file and opening it")
-
-    AbstractAudioFile* pAudioFile = nullptr;
-
-    // Get the file format.
-    int format = checkFileFormat(filePath);
-
-    // Create the audio file stream base on the file format (if supported).
-    switch (format)
-    {
-#ifdef USE_WAVE
-    case WAVE:
-    {
-        pAudioFile = new WaveAudioFile(filePath);
-    } break;
-#endif
+    std::vector<AbstractAudioFile*> files;
+    files.reserve(m_queueOpenedFile.size());
+    for (const std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+        files.push_back(file.get());
+    m_activeFiles.publish(std::move(files));
+}
 
-#ifdef USE_FLAC
-    case FLAC:
+void Player::markRemovedRefillFiles()
+{
+    std::scoped_lock lock(m_refillTaskMutex);
+    for (RefillFile& refill : m_refillFiles)
     {
-        pAudioFile = new FlacAudioFile(filePath);
-    } break;
-#endif
+        if (std::find(m_queueOpenedFile.cbegin(), m_queueOpenedFile.cend(), refill.file) == m_queueOpenedFile.cend())
+            refill.isRemoved = true;
+    }
+}
 
-#ifdef USE_LIBSNDFILE
-    case SNDFILE:
-    {
-        pAudioFile = new SndAudioFile(filePath);
-    } break;
-#endif
+AbstractAudioFile* Player::detectAndOpenFile(const std::string& filePath) const
+{
+    SAL_DEBUG_LOOP_UPDATE("Detecting audio format type of a file and opening it")
 
-    case UNKNOWN_FILE:
-    default:
-    {} break;
-    }
+    // The format is detected from the first bytes of the file and the file is opened once.
+    AbstractAudioFile* pAudioFile = FormatProbe::open(filePath);
 
     SAL_DEBUG_LOOP_UPDATE("Detecting audio format type of a file and opening it done")
     
@@ -413,34 +460,26 @@ AbstractAudioFile* Player::detectAndOpenFile(const std::string& filePath) const
 
 int Player::checkFileFormat(const std::string& filePath) const
 {
-    // Trying to read the file with the different implementation to check which one to use.
-#ifdef USE_WAVE
-    if (WaveAudioFile(filePath).isOpen())
-        return WAVE;
-#endif
-#ifdef USE_FLAC
-    if (FlacAudioFile(filePath).isOpen())
-        return FLAC;
-#endif
-#ifdef USE_LIBSNDFILE
-    if (SndAudioFile(filePath).isOpen())
-        return SNDFILE;
-#endif
-
-    return UNKNOWN_FILE;
+    // Only the magic bytes at the start of the file are read.
+    return FormatProbe::probe(filePath);
 }
 
 void Player::_resetStreamInfo()
 {
     SAL_DEBUG_STREAM_STATUS("Resetting stream informations and closing stream")
 
-    m_paStream.reset();
+    m_sink.reset();
     m_isClosingStreamTheStream = false;
+    // The files are deleted once the stream callback stopped using them.
+    std::vector<std::shared_ptr<AbstractAudioFile>> files = std::move(m_queueOpenedFile);
     m_queueOpenedFile.clear();
+    publishActiveFiles();
+    markRemovedRefillFiles();
     m_numChannels = 0;
     m_sampleRate = 0;
     m_bytesPerSample = 0;
     m_sampleType = SampleType::UNKNOWN;
+    m_isConvertingStream = false;
     m_isPaused = false;
     m_isBuffering = false;
     if (m_isPlaying)
@@ -467,6 +506,8 @@ bool Player::checkStreamInfo(const AbstractAudioFile* const file) const
 {
     if (!file)
         return false;
+    if (m_isConvertingStream && m_numChannels > 0 && m_sampleRate > 0)
+        return file->numChannels() > 0 && file->sampleRate() > 0;
     bool isSame = true;
     if (file->numChannels() != m_numChannels)
         isSame = false;
@@ -483,11 +524,11 @@ bool Player::createStream()
 {
     SAL_DEBUG_STREAM_STATUS("Creating a new stream sink")
 
-    if (m_paStream)
+    if (m_sink)
     {
         SAL_DEBUG_STREAM_STATUS("Closing current stream sink")
 
-        m_paStream.reset();
+        m_sink.reset();
     }
     
     if (m_queueOpenedFile.empty())
@@ -497,11 +538,14 @@ bool Player::createStream()
         return false;
     }
 
-    // Retrieve PCM info from the stream.
+    // Retrieve PCM info from the stream, the output format replace the one of the file when converting.
     AbstractAudioFile* audioFile;
     audioFile = m_queueOpenedFile.at(0).get();
-    m_numChannels = audioFile->numChannels();
-    m_sampleRate = audioFile->sampleRate();
+    OutputFormat format = outputFormat();
+    m_isConvertingStream = format.isConverting;
+    m_resamplerQuality = format.resamplerQuality;
+    m_numChannels = format.isConverting && format.numChannels > 0 ? format.numChannels : audioFile->numChannels();
+    m_sampleRate = format.isConverting && format.sampleRate > 0 ? format.sampleRate : audioFile->sampleRate();
     m_bytesPerSample = audioFile->streamBytesPerSample();
     m_sampleType = audioFile->streamSampleType();
 
@@ -515,53 +559,33 @@ bool Player::createStream()
         return false;
     }
 
-    // Retrieve the default output device.
-    PaHostApiIndex hostApiIndex = Pa_HostApiTypeIdToHostApiIndex((PaHostApiTypeId)fromBackendEnumToHostAPI(m_backendAudio));
-    PaDeviceIndex outputDevice = Pa_GetHostApiInfo(hostApiIndex)->defaultOutputDevice;
-
-    // Set the info of the PortAudio stream.
-    PaStreamParameters outParams = {};
-    outParams.device = outputDevice;
-    outParams.channelCount = m_numChannels;
-    if (m_sampleType == SampleType::FLOAT)
+    // The sinks are only receiving 32 bits floating point numbers.
+    if (m_sampleType != SampleType::FLOAT || m_bytesPerSample != 4)
     {
-        if (m_bytesPerSample == 4)
-            outParams.sampleFormat = paFloat32;
-        else
-        {
-            SAL_DEBUG_STREAM_STATUS("Creating a new stream sink failed: not valid floating point number")
+        SAL_DEBUG_STREAM_STATUS("Creating a new stream sink failed: not valid floating point number")
 
-            resetStreamInfo();
-            return false;
-        }
+        resetStreamInfo();
+        return false;
     }
-    outParams.suggestedLatency = Pa_GetDeviceInfo(outputDevice)->defaultHighOutputLatency;
-    outParams.hostApiSpecificStreamInfo = nullptr;
-
-    // Create the PortAudio stream.
-    PaStream* pStream;
-    PaError err = Pa_OpenStream(
-        &pStream,
-        nullptr,
-        &outParams,
-        (double)m_sampleRate,
-        paFramesPerBufferUnspecified,
-        paNoFlag,
-        staticPortAudioStreamCallback,
-        this);
-    
-    if (err != paNoError)
+
+    // Create the output sink and open the stream.
+    std::unique_ptr<AudioSink> sink(
+        AudioSink::create(audioSink(), fromBackendEnumToHostAPI(m_backendAudio)));
+    if (!sink->open(m_numChannels, m_sampleRate, staticStreamCallback, staticEndStream, this))
     {
-        SAL_DEBUG_STREAM_STATUS(std::string("Creating a new stream sink failed: creating portaudio stream failed: ") + Pa_GetErrorText(err))
+        SAL_DEBUG_STREAM_STATUS("Creating a new stream sink failed: opening the sink failed: " + sink->lastError())
 
         resetStreamInfo();
         return false;
     }
-    
-    Pa_SetStreamFinishedCallback(pStream, Player::staticPortAudioEndStream);
-    
-    m_paStream = std::unique_ptr<PaStream, decltype(&Pa_CloseStream)>
-        (pStream, Pa_CloseStream);
+    m_sink = std::move(sink);
+
+    // The stream callback cannot allocate, the crossfade buffer is allocated with the stream.
+    m_crossfadeBuffer.assign(CROSSFADE_BLOCK_FRAMES * m_numChannels * 3, 0.0f);
+
+    // The files already opened are converted to the format of the stream.
+    for (std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+        file->setOutputFormat(m_numChannels, m_sampleRate, m_resamplerQuality);
 
     // checkStreamInfo may be called before createStream, which lead to a fail even if the next stream is compatible.
     m_doNotCheckFile = false;
@@ -571,63 +595,115 @@ bool Player::createStream()
     return true;
 }
 
-int Player::staticPortAudioStreamCallback(
-    const void* inputBuffer,
+AudioSink::StreamResult Player::staticStreamCallback(
     void* outputBuffer,
     unsigned long framesPerBuffer,
-    const PaStreamCallbackTimeInfo* timeInfo,
-    unsigned long flags,
+    unsigned long& framesWritten,
     void* data)
 {
     Player* pPlayer = static_cast<Player*>(data);
     return std::invoke(&Player::streamCallback, pPlayer,
-        inputBuffer, outputBuffer, framesPerBuffer);
+        outputBuffer, framesPerBuffer, framesWritten);
 }
 
-void Player::staticPortAudioEndStream(void* data)
+void Player::staticEndStream(void* data)
 {
     Player* pPlayer = static_cast<Player*>(data);
     std::invoke(&Player::streamEndCallback, pPlayer);
 }
 
-int Player::streamCallback(
-    const void* inputBuffer,
+AudioSink::StreamResult Player::streamCallback(
     void* outputBuffer,
-    unsigned long framesPerBuffer)
+    unsigned long framesPerBuffer,
+    unsigned long& framesWritten)
 {
-    SAL_DEBUG_READ_STREAM("Send audio from ring buffer to PortAudio")
+    SAL_DEBUG_READ_STREAM("Send audio from ring buffer to the sink")
 
-    std::scoped_lock lock(m_queueFilePathMutex, m_queueOpenedFileMutex);
-    if (m_queueOpenedFile.empty())
+    framesWritten = 0;
+
+    // The files stay valid until the end of the read section.
+    ActiveList<AbstractAudioFile*>::ReadSection section(m_activeFiles);
+    const std::vector<AbstractAudioFile*>& files = section.items();
+    if (files.empty())
     {
         SAL_DEBUG_READ_STREAM("No audio data to stream, closing the stream")
 
-        return paComplete;
+        return AudioSink::StreamResult::COMPLETE;
+    }
+
+    // The main loop is seeking.
+    if (m_isStreamSuspended)
+    {
+        memset(outputBuffer, 0, framesPerBuffer*m_bytesPerSample*m_numChannels);
+        return AudioSink::StreamResult::BUFFERING;
     }
 
     size_t framesWrited = 0;
     bool isBuffering = false;
+    bool isWakeUpNeeded = false;
+
+    // The file playing and the next one, they are crossfaded at the end of the file playing.
+    AbstractAudioFile* current = nullptr;
+    AbstractAudioFile* next = nullptr;
+    const size_t crossfadeFrames = (size_t)m_crossfadeDuration * m_sampleRate / 1000;
+    if (crossfadeFrames > 0)
+    {
+        for (size_t i = 0; i + 1 < files.size(); i++)
+        {
+            if (!files[i]->isEnded())
+            {
+                current = files[i];
+                next = files[i+1];
+                break;
+            }
+        }
+    }
+
+    if (!m_isBuffering && next && current->remainingOutputFrames() < crossfadeFrames + framesPerBuffer)
+    {
+        framesWrited = crossfadeFiles(current, next, static_cast<float*>(outputBuffer),
+            framesPerBuffer, crossfadeFrames, isBuffering);
+
+        // Both files ended in the buffer.
+        if (framesWrited < framesPerBuffer && !isBuffering)
+        {
+            if (!next->isEnded())
+                isBuffering = next->bufferingSize() == 0 && !next->isEndFile();
+            // The file after the next one is played from the next buffer.
+            else if (next != files.back())
+                framesWrited = framesPerBuffer;
+        }
 
-    if (!m_isBuffering)
+        // The main loop is refilling the ring buffers or removing the ended file.
+        bool isCurrentWakingUp = current->isLowWatermarkCrossed() || current->isEnded();
+        bool isNextWakingUp = next->isLowWatermarkCrossed();
+        if (isCurrentWakingUp || isNextWakingUp || isBuffering)
+            isWakeUpNeeded = true;
+    }
+    else if (!m_isBuffering)
     {
         // Process all the opened files until outputBuffer is full.
-        for (std::unique_ptr<AbstractAudioFile>& audioFile : m_queueOpenedFile)
+        for (AbstractAudioFile* audioFile : files)
         {
             // Get data from file until the outputBuffer is full and audioFile is not at the end.
             while (framesWrited < framesPerBuffer && !audioFile->isEnded())
             {
-                framesWrited += audioFile->read(static_cast<char*>(outputBuffer)+framesWrited*audioFile->streamBytesPerFrame(),
+                framesWrited += audioFile->readOutput(static_cast<char*>(outputBuffer)+framesWrited*m_numChannels*m_bytesPerSample,
                     framesPerBuffer-framesWrited);
                 
                 if (audioFile->bufferingSize() == 0)
                     break;
             }
 
+            // The main loop is refilling the ring buffer or removing the ended file.
+            if (audioFile->isLowWatermarkCrossed() || audioFile->isEnded())
+                isWakeUpNeeded = true;
+
             // If not enough data, pause the stream to let the audio file buffer to fill.
             if (audioFile->bufferingSize() == 0 && (!audioFile->isEnded() && !audioFile->isEndFile()))
             {
                 isBuffering = true;
-                streamBufferingCallback();
+                isWakeUpNeeded = true;
                 break;
             }
 
@@ -637,9 +713,17 @@ int Player::streamCallback(
         }
     }
 
-    // Call stream position change in frames.
-    streamPosChangeInFrames(m_queueOpenedFile.at(0)->streamPos());
+    // Publish the stream position, the callbacks are called by the dispatcher thread.
+    streamPosChange(files.at(0)->streamPos(), files.at(0)->sampleRate());
 
+    // The main loop must see the buffering once it is woken up.
+    if (isBuffering && framesWrited < framesPerBuffer)
+        m_isBuffering = true;
+
+    if (isWakeUpNeeded)
+        wakeUpMainLoop();
+
+    framesWritten = framesWrited;
     if (framesWrited < framesPerBuffer)
     {
         // If the output buffer is not full, fill the end of the buffer with null data (to prevent artefacts).
@@ -652,21 +736,92 @@ int Player::streamCallback(
         {
             SAL_DEBUG_READ_STREAM("Stream buffering")
 
-            m_isBuffering = true; 
-            return paContinue;
+            return AudioSink::StreamResult::BUFFERING;
         }
 
         if (!m_isBuffering)
         {
             SAL_DEBUG_READ_STREAM("No more data to read")
 
-            return paComplete;
+            return AudioSink::StreamResult::COMPLETE;
         }
+
+        return AudioSink::StreamResult::BUFFERING;
     }
 
-    SAL_DEBUG_READ_STREAM("Send audio from ring buffer to PortAudio done")
+    SAL_DEBUG_READ_STREAM("Send audio from ring buffer to the sink done")
 
-    return paContinue;
+    return AudioSink::StreamResult::CONTINUE;
+}
+
+size_t Player::crossfadeFiles(
+    AbstractAudioFile* current,
+    AbstractAudioFile* next,
+    float* output,
+    size_t framesPerBuffer,
+    size_t crossfadeFrames,
+    bool& isBuffering)
+{
+    const int numChannels = m_numChannels;
+    const CrossfadeCurve curve = m_crossfadeCurve;
+
+    // Position in the crossfade of the first frame of the buffer, the crossfade may start later in the buffer.
+    const size_t remaining = current->remainingOutputFrames();
+    const size_t fadeStart = remaining > crossfadeFrames ? remaining - crossfadeFrames : 0;
+    const size_t fadePos = crossfadeFrames > remaining ? crossfadeFrames - remaining : 0;
+
+    // The current file fill the buffer as if there was no crossfade.
+    size_t currentFrames = 0;
+    while (currentFrames < framesPerBuffer && !current->isEnded())
+    {
+        currentFrames += current->readOutput(reinterpret_cast<char*>(output + currentFrames * numChannels),
+            framesPerBuffer - currentFrames);
+        if (current->bufferingSize() == 0)
+            break;
+    }
+    memset(output + currentFrames * numChannels, 0, (framesPerBuffer - currentFrames) * numChannels * sizeof(float));
+
+    if (current->bufferingSize() == 0 && !current->isEnded() && !current->isEndFile())
+    {
+        isBuffering = true;
+        return currentFrames;
+    }
+
+    // The next file is mixed from the start of the crossfade, block by block.
+    float* nextBlock = m_crossfadeBuffer.data();
+    float* currentGains = nextBlock + CROSSFADE_BLOCK_FRAMES * numChannels;
+    float* nextGains = currentGains + CROSSFADE_BLOCK_FRAMES * numChannels;
+    size_t framesMixed = fadeStart < framesPerBuffer ? fadeStart : framesPerBuffer;
+    size_t position = fadePos;
+    size_t nextEnd = framesMixed;
+    while (framesMixed < framesPerBuffer)
+    {
+        size_t blockFrames = framesPerBuffer - framesMixed;
+        if (blockFrames > CROSSFADE_BLOCK_FRAMES)
+            blockFrames = CROSSFADE_BLOCK_FRAMES;
+
+        size_t nextFrames = 0;
+        while (nextFrames < blockFrames && !next->isEnded())
+        {
+            size_t framesRead = next->readOutput(reinterpret_cast<char*>(nextBlock + nextFrames * numChannels),
+                blockFrames - nextFrames);
+            nextFrames += framesRead;
+            if (framesRead == 0)
+                break;
+        }
+        memset(nextBlock + nextFrames * numChannels, 0, (blockFrames - nextFrames) * numChannels * sizeof(float));
+        if (nextFrames > 0)
+            nextEnd = framesMixed + nextFrames;
+
+        MixKernels::crossfadeGains(curve, position, crossfadeFrames, currentGains, nextGains, blockFrames, numChannels);
+        MixKernels::crossfade(output + framesMixed * numChannels, nextBlock, currentGains, nextGains,
+            blockFrames * numChannels);
+
+        framesMixed += blockFrames;
+        position += blockFrames;
+    }
+
+    return currentFrames > nextEnd ? currentFrames : nextEnd;
 }
 
 void Player::streamEndCallback()
@@ -675,14 +830,9 @@ void Player::streamEndCallback()
 
     if (!m_isPaused && !m_isBuffering)
     {
-        {
-            // Call end stream callback.
-            std::scoped_lock lock(m_queueOpenedFileMutex);
-            if (!m_queueOpenedFile.empty() && !m_isStopping)
-                endStreamingFile(m_queueOpenedFile.at(0)->filePath());
-        }
-        //resetStreamInfo();
+        // The end file callback is called by the main loop when closing the stream.
         m_isClosingStreamTheStream = true;
+        wakeUpMainLoop();
     }
 
     SAL_DEBUG("End of stream callback done")
@@ -707,11 +857,58 @@ void Player::update()
     recreateStream();
     std::scoped_lock lock(m_queueFilePathMutex, m_queueOpenedFileMutex);
     checkIfNoStream();
-    streamPosChangeCallback();
 
     SAL_DEBUG_LOOP_UPDATE("update loop: reading data from file and clearing unneeded streams done")
 }
 
+std::chrono::steady_clock::duration Player::timeBeforeNextUpdate()
+{
+    std::scoped_lock lock(m_queueFilePathMutex, m_queueOpenedFileMutex);
+
+    // A file is waiting to be opened.
+    if (m_queueOpenedFile.size() < static_cast<size_t>(m_maxInStreamQueue.load()) &&
+        !m_queueFilePath.empty() && !m_doNotCheckFile)
+        return std::chrono::steady_clock::duration::zero();
+
+    // Keep reading until the ring buffers are full.
+    if (!m_decodePool)
+    {
+        for (std::shared_ptr<AbstractAudioFile>& audioFile : m_queueOpenedFile)
+        {
+            if (audioFile->isRefilling())
+                return std::chrono::steady_clock::duration::zero();
+        }
+    }
+    // The refill tasks wake up the main loop when they are done, the files not refilled yet are scheduled.
+    else
+    {
+        std::scoped_lock lock(m_refillTaskMutex);
+        for (size_t i = 0; i < m_queueOpenedFile.size() && timeBeforeReading(i) == 0; i++)
+        {
+            std::shared_ptr<AbstractAudioFile>& audioFile = m_queueOpenedFile[i];
+            bool isScheduled = std::any_of(m_refillFiles.cbegin(), m_refillFiles.cend(),
+                [&audioFile](const RefillFile& refill) { return refill.file == audioFile; });
+            if (!isScheduled && audioFile->isRefillNeeded())
+                return std::chrono::steady_clock::duration::zero();
+        }
+    }
+
+    // Wait until the next file can be read, while the file before it is playing.
+    for (size_t i = 1; i < m_queueOpenedFile.size(); i++)
+    {
+        const size_t timeBeforeRead = timeBeforeReading(i);
+        if (timeBeforeRead > 0)
+        {
+            if (_isPlaying() && !m_isPaused)
+                return std::chrono::milliseconds(timeBeforeRead);
+            break;
+        }
+    }
+
+    // Nothing to do until an event or the stream callback wake up the main loop.
+    return std::chrono::steady_clock::duration::max();
+}
+
 bool Player::isPaused() const
 {
     return m_isPaused;
@@ -725,9 +922,12 @@ void Player::pauseIfBuffering()
     {
         SAL_DEBUG_STREAM_STATUS("Buffering: pausing the stream")
 
+        // The stream callback cannot call it, it is not allowed to lock.
+        streamBufferingCallback();
+
 //        bool isError = false;
         {
-//            std::scoped_lock lock(m_paStreamMutex);
+//            std::scoped_lock lock(m_sinkMutex);
             m_isPaused = true;
 //            PaError err = Pa_StopStream(m_paStream.get());
 //            if (err != paNoError)
@@ -756,12 +956,13 @@ void Player::continuePlayingIfEnoughBuffering()
     {
 //        bool isStartStreamFailed = false;
         {
-            std::scoped_lock lock(m_paStreamMutex, m_queueOpenedFileMutex);
-            for (const std::unique_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+            std::scoped_lock lock(m_sinkMutex, m_queueOpenedFileMutex);
+            for (const std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
             {
                 if (!file->isEnded())
                 {
-                    if (file->isEnoughBuffering())
+                    // A file shorter than the high watermark is fully read before reaching it.
+                    if (file->isEnoughBuffering() || file->isEndFile())
                     {
                         SAL_DEBUG_STREAM_STATUS("Enough buffering, resume stream")
 
@@ -804,7 +1005,10 @@ void Player::clearUnneededStream()
             // Notify that the file ended.
             endStreamingFile(m_queueOpenedFile.at(0)->filePath());
             
+            std::shared_ptr<AbstractAudioFile> file = std::move(m_queueOpenedFile.at(0));
             m_queueOpenedFile.erase(m_queueOpenedFile.cbegin());
+            publishActiveFiles();
+            markRemovedRefillFiles();
 
             // Notify of the new file streaming.
             if (!m_queueOpenedFile.empty())
@@ -823,7 +1027,7 @@ void Player::recreateStream()
     if (!m_isPlaying)
         return;
     
-    if (!m_paStream)
+    if (!m_sink)
     {
         if (!m_queueOpenedFile.empty())
         {
@@ -833,11 +1037,11 @@ void Player::recreateStream()
             {
                 _resetStreamInfo();
                 m_isPlaying = false;
+                return;
             }
             
-            std::scoped_lock lock(m_paStreamMutex, m_queueOpenedFileMutex);
-            PaError err = Pa_StartStream(m_paStream.get());
-            if (err == paNoError)
+            std::scoped_lock lock(m_sinkMutex, m_queueOpenedFileMutex);
+            if (m_sink->start())
             {
                 SAL_DEBUG_STREAM_STATUS("Recreating a new stream sink done")
 
@@ -850,7 +1054,7 @@ void Player::recreateStream()
             else
             {
 #ifndef NDEBUG
-                SAL_DEBUG_STREAM_STATUS(std::string("Recreating a new stream sink failed: starting the stream failed: ") + Pa_GetErrorText(err))
+                SAL_DEBUG_STREAM_STATUS("Recreating a new stream sink failed: starting the stream failed: " + m_sink->lastError())
 #endif
 
                 m_isPaused = false;
@@ -866,7 +1070,13 @@ void Player::closeStreamWhenNeeded()
     if (m_isClosingStreamTheStream)
     {
         SAL_DEBUG("Closing the stream")
-        std::scoped_lock lock(m_paStreamMutex);
+        {
+            // Call end stream callback.
+            std::scoped_lock lock(m_queueOpenedFileMutex);
+            if (!m_queueOpenedFile.empty() && !m_isStopping)
+                endStreamingFile(m_queueOpenedFile.at(0)->filePath());
+        }
+        std::scoped_lock lock(m_sinkMutex);
         resetStreamInfo();
         SAL_DEBUG("Closing the stream done")
     }
@@ -878,15 +1088,111 @@ void Player::updateStreamBuffer()
 {
     SAL_DEBUG_LOOP_UPDATE("Reading data from files")
 
-    for (std::unique_ptr<AbstractAudioFile>& audioFile : m_queueOpenedFile)
+    // The files are read by the decode pool, the main loop only schedule them.
+    if (m_decodePool)
+    {
+        std::scoped_lock lock(m_refillTaskMutex);
+        for (size_t i = 0; i < m_queueOpenedFile.size(); i++)
+        {
+            std::shared_ptr<AbstractAudioFile>& audioFile = m_queueOpenedFile[i];
+            if (timeBeforeReading(i) > 0)
+                break;
+
+            bool isScheduled = std::any_of(m_refillFiles.cbegin(), m_refillFiles.cend(),
+                [&audioFile](const RefillFile& refill) { return refill.file == audioFile; });
+            if (isScheduled || !audioFile->isRefillNeeded())
+                continue;
+
+            m_refillFiles.push_back({ audioFile, false, false });
+            m_refillTasks++;
+            m_decodePool->submit(std::bind(&Player::refillFiles, this));
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < m_queueOpenedFile.size() && timeBeforeReading(i) == 0; i++)
     {
-        audioFile->readFromFile();
-        audioFile->flush();
+        m_queueOpenedFile[i]->readFromFile();
+        m_queueOpenedFile[i]->flush();
     }
 
     SAL_DEBUG_LOOP_UPDATE("Reading data from files done")
 }
 
+size_t Player::timeBeforeReading(size_t index) const
+{
+    // The file start playing once the files before it are played.
+    size_t duration = 0;
+    for (size_t i = 0; i < index; i++)
+        duration += remainingDuration(*m_queueOpenedFile[i]);
+
+    const size_t prefetchDuration = m_bufferingPolicy.lowWatermarkMs + m_crossfadeDuration;
+    return duration > prefetchDuration ? duration - prefetchDuration : 0;
+}
+
+void Player::refillFiles()
+{
+    SAL_DEBUG_READ_FILE("Refilling a file on the decode pool")
+
+    std::shared_ptr<AbstractAudioFile> file;
+    bool isRemoved = false;
+    {
+        std::scoped_lock lock(m_refillTaskMutex);
+
+        // The file the less buffered and not read by another task.
+        std::vector<RefillFile>::iterator next = m_refillFiles.end();
+        for (std::vector<RefillFile>::iterator it = m_refillFiles.begin(); it != m_refillFiles.end(); it++)
+        {
+            if (!it->isReading &&
+                (next == m_refillFiles.end() || bufferingDuration(*it->file) < bufferingDuration(*next->file)))
+                next = it;
+        }
+        next->isReading = true;
+        file = next->file;
+        isRemoved = next->isRemoved;
+    }
+
+    /*
+    Only one temporary buffer is read, the other files (and the other
+    players sharing the pool) are read in between. A file removed from
+    the queue is not read anymore.
+    */
+    bool isRefilling = false;
+    if (!isRemoved)
+    {
+        file->readFromFile();
+        file->flush();
+        isRefilling = file->isRefilling();
+    }
+
+    // The main loop resume the stream once there is enough buffering.
+    if (m_isBuffering)
+        wakeUpMainLoop();
+
+    std::scoped_lock lock(m_refillTaskMutex);
+    std::vector<RefillFile>::iterator it = std::find_if(m_refillFiles.begin(), m_refillFiles.end(),
+        [&file](const RefillFile& refill) { return refill.file == file; });
+    it->isReading = false;
+    file.reset();
+
+    if (isRefilling && !it->isRemoved && !m_isRefillStopping)
+    {
+        m_decodePool->submit(std::bind(&Player::refillFiles, this));
+        return;
+    }
+
+    /*
+    The ring buffer is full, the task end. The player may be destroyed as soon as
+    the lock is released. The main loop check the files opened in the meantime.
+    */
+    m_refillFiles.erase(it);
+    m_refillTasks--;
+    wakeUpMainLoop();
+    m_refillTaskCV.notify_all();
+
+    SAL_DEBUG_READ_FILE("Refilling a file on the decode pool done")
+}
+
 void Player::checkIfNoStream()
 {
     if (m_isPlaying && m_queueFilePath.empty() && m_queueOpenedFile.empty())
@@ -917,6 +1223,63 @@ void Player::setBackendAudio(BackendAudio backend)
     m_backendAudio = backend;
 }
 
+void Player::setBufferingPolicy(const BufferingPolicy& policy)
+{
+    std::scoped_lock lock(m_queueOpenedFileMutex);
+    m_bufferingPolicy = policy;
+    // At least the current file is opened.
+    if (m_bufferingPolicy.prefetchDepth < 1)
+        m_bufferingPolicy.prefetchDepth = 1;
+    m_maxInStreamQueue = m_bufferingPolicy.prefetchDepth;
+
+    for (std::shared_ptr<AbstractAudioFile>& file : m_queueOpenedFile)
+        file->setBufferingPolicy(m_bufferingPolicy);
+}
+
+void Player::setAudioSink(const AudioSinkConfig& config)
+{
+    std::scoped_lock lock(m_sinkConfigMutex);
+    m_sinkConfig = config;
+}
+
+AudioSinkConfig Player::audioSink() const
+{
+    std::scoped_lock lock(m_sinkConfigMutex);
+    return m_sinkConfig;
+}
+
+void Player::setOutputFormat(const OutputFormat& format)
+{
+    std::scoped_lock lock(m_sinkConfigMutex);
+    m_outputFormat = format;
+}
+
+OutputFormat Player::outputFormat() const
+{
+    std::scoped_lock lock(m_sinkConfigMutex);
+    return m_outputFormat;
+}
+
+void Player::setCrossfade(const CrossfadeConfig& config)
+{
+    m_crossfadeCurve = config.curve;
+    m_crossfadeDuration = config.duration > 0 ? config.duration : 0;
+}
+
+CrossfadeConfig Player::crossfade() const
+{
+    CrossfadeConfig config;
+    config.duration = m_crossfadeDuration;
+    config.curve = m_crossfadeCurve;
+    return config;
+}
+
+BufferingPolicy Player::bufferingPolicy() const
+{
+    std::scoped_lock lock(m_queueOpenedFileMutex);
+    return m_bufferingPolicy;
+}
+
 BackendAudio Player::getSystemDefaultBackendAudio() const
 {
     PaHostApiIndex hostApiIndex = Pa_GetDefaultHostApi();
@@ -1005,29 +1368,13 @@ inline void Player::endStreamingFile(const std::string& filePath)
                     filePath);
 }
 
-inline void Player::streamPosChangeInFrames(size_t streamPos)
+inline void Player::streamPosChange(size_t streamPos, size_t sampleRate)
 {
     if (m_callbackInterface)
-        std::invoke(&CallbackInterface::callStreamPosChangeCallback,
+        std::invoke(&CallbackInterface::setStreamPos,
                     m_callbackInterface,
                     streamPos,
-                    TimeType::FRAMES);
-}
-
-inline void Player::streamPosChangeCallback()
-{
-    if (m_callbackInterface && !m_queueOpenedFile.empty() && _isPlaying())
-    {
-        size_t pos = _streamPos(TimeType::SECONDS);
-        if (pos != m_streamPosLastCallback)
-        {
-            m_streamPosLastCallback = pos;
-            std::invoke(&CallbackInterface::callStreamPosChangeCallback,
-                        m_callbackInterface,
-                        m_streamPosLastCallback,
-                        TimeType::SECONDS);
-        }
-    }
+                    sampleRate);
 }
 
 inline void Player::streamPausedCallback()
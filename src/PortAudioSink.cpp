@@ -0,0 +1,138 @@
+#include "PortAudioSink.h"
+#include "DebugLog.h"
+#include <portaudio.h>
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "PortAudioSink";
+
+namespace SAL
+{
+PortAudioSink::PortAudioSink(int hostApiType) :
+    m_hostApiType(hostApiType),
+    m_stream(nullptr),
+    m_streamCallback(nullptr),
+    m_finishedCallback(nullptr),
+    m_data(nullptr)
+{}
+
+PortAudioSink::~PortAudioSink()
+{
+    close();
+}
+
+bool PortAudioSink::open(
+    int numChannels,
+    size_t sampleRate,
+    StreamCallback streamCallback,
+    FinishedCallback finishedCallback,
+    void* data)
+{
+    close();
+
+    m_streamCallback = streamCallback;
+    m_finishedCallback = finishedCallback;
+    m_data = data;
+
+    // Retrieve the default output device.
+    PaHostApiIndex hostApiIndex = Pa_HostApiTypeIdToHostApiIndex((PaHostApiTypeId)m_hostApiType);
+    const PaHostApiInfo* hostApiInfo = Pa_GetHostApiInfo(hostApiIndex);
+    if (!hostApiInfo || hostApiInfo->defaultOutputDevice == paNoDevice)
+    {
+        m_lastError = "no output device";
+        SAL_DEBUG_STREAM_STATUS("Opening PortAudio stream failed: no output device")
+
+        return false;
+    }
+    PaDeviceIndex outputDevice = hostApiInfo->defaultOutputDevice;
+
+    // Set the info of the PortAudio stream.
+    PaStreamParameters outParams = {};
+    outParams.device = outputDevice;
+    outParams.channelCount = numChannels;
+    outParams.sampleFormat = paFloat32;
+    outParams.suggestedLatency = Pa_GetDeviceInfo(outputDevice)->defaultHighOutputLatency;
+    outParams.hostApiSpecificStreamInfo = nullptr;
+
+    // Create the PortAudio stream.
+    PaError err = Pa_OpenStream(
+        &m_stream,
+        nullptr,
+        &outParams,
+        (double)sampleRate,
+        paFramesPerBufferUnspecified,
+        paNoFlag,
+        staticPortAudioStreamCallback,
+        this);
+
+    if (err != paNoError)
+    {
+        m_stream = nullptr;
+        m_lastError = Pa_GetErrorText(err);
+        SAL_DEBUG_STREAM_STATUS(std::string("Opening PortAudio stream failed: ") + m_lastError)
+
+        return false;
+    }
+
+    Pa_SetStreamFinishedCallback(m_stream, staticPortAudioEndStream);
+
+    return true;
+}
+
+bool PortAudioSink::start()
+{
+    if (!m_stream)
+    {
+        m_lastError = "stream not opened";
+        return false;
+    }
+
+    PaError err = Pa_StartStream(m_stream);
+    if (err != paNoError)
+    {
+        m_lastError = Pa_GetErrorText(err);
+        return false;
+    }
+    return true;
+}
+
+void PortAudioSink::stop()
+{
+    if (m_stream)
+        Pa_StopStream(m_stream);
+}
+
+void PortAudioSink::close()
+{
+    if (m_stream)
+    {
+        Pa_CloseStream(m_stream);
+        m_stream = nullptr;
+    }
+}
+
+int PortAudioSink::staticPortAudioStreamCallback(
+    const void* inputBuffer,
+    void* outputBuffer,
+    unsigned long framesPerBuffer,
+    const PaStreamCallbackTimeInfo* timeInfo,
+    unsigned long flags,
+    void* data)
+{
+    PortAudioSink* sink = static_cast<PortAudioSink*>(data);
+    unsigned long framesWritten = 0;
+    StreamResult result = sink->m_streamCallback(
+        outputBuffer, framesPerBuffer, framesWritten, sink->m_data);
+
+    // The device keep playing while buffering, the silence is played.
+    if (result == StreamResult::COMPLETE)
+        return paComplete;
+    return paContinue;
+}
+
+void PortAudioSink::staticPortAudioEndStream(void* data)
+{
+    PortAudioSink* sink = static_cast<PortAudioSink*>(data);
+    if (sink->m_finishedCallback)
+        sink->m_finishedCallback(sink->m_data);
+}
+}
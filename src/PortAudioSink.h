@@ -0,0 +1,62 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_PORTAUDIOSINK_H_
+#define SIMPLE_AUDIO_LIBRARY_PORTAUDIOSINK_H_
+
+#include "AudioSink.h"
+
+struct PaStreamCallbackTimeInfo;
+typedef void PaStream;
+
+namespace SAL
+{
+/*
+Sink playing the stream on the default output device
+of a PortAudio host API.
+*/
+class PortAudioSink : public AudioSink
+{
+    PortAudioSink(const PortAudioSink& other) = delete;
+public:
+    /*
+    hostApiType: PortAudio host API type (PaHostApiTypeId).
+    */
+    PortAudioSink(int hostApiType);
+    virtual ~PortAudioSink();
+
+    virtual bool open(
+        int numChannels,
+        size_t sampleRate,
+        StreamCallback streamCallback,
+        FinishedCallback finishedCallback,
+        void* data) override;
+    virtual bool start() override;
+    virtual void stop() override;
+
+private:
+    /*
+    Close the PortAudio stream.
+    */
+    void close();
+
+    /*
+    Static C callbacks use to make a bridge between
+    PortAudio and the stream callbacks.
+    */
+    static int staticPortAudioStreamCallback(
+        const void* inputBuffer,
+        void* outputBuffer,
+        unsigned long framesPerBuffer,
+        const PaStreamCallbackTimeInfo* timeInfo,
+        unsigned long flags,
+        void* data);
+    static void staticPortAudioEndStream(void* data);
+
+    int m_hostApiType;
+    PaStream* m_stream;
+
+    StreamCallback m_streamCallback;
+    FinishedCallback m_finishedCallback;
+    void* m_data;
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_PORTAUDIOSINK_H_
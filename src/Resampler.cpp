@@ -0,0 +1,319 @@
+#include "Resampler.h"
+#include "SampleConverter.h"
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <tuple>
+
+#ifdef SAL_SSE2_KERNELS
+#include <emmintrin.h>
+#endif
+#ifdef SAL_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+
+// Maximum number of input frames waiting to be resampled.
+#define RESAMPLER_INPUT_FRAMES 4096
+// Maximum number of phases of a filter table.
+#define RESAMPLER_MAX_PHASES 1024
+// Maximum number of taps of a phase when downsampling.
+#define RESAMPLER_MAX_TAPS 256
+
+namespace SAL
+{
+namespace
+{
+/*
+Parameters of a quality preset.
+- taps: number of taps of a phase when upsampling.
+- rolloff: cutoff frequency relative to the Nyquist frequency.
+- beta: shape of the Kaiser window.
+*/
+struct QualityPreset
+{
+    size_t taps;
+    double rolloff;
+    double beta;
+};
+
+const QualityPreset QUALITY_PRESETS[] = {
+    {16, 0.85, 6.0},
+    {32, 0.91, 8.5},
+    {64, 0.95, 11.0}};
+
+// Sample rates of the tables computed the first time a quality is used.
+const size_t COMMON_SAMPLE_RATES[] = {44100, 48000, 96000};
+
+/*
+Modified Bessel function of the first kind of order zero.
+*/
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++)
+    {
+        double half = x / (2.0 * k);
+        term *= half * half;
+        sum += term;
+    }
+    return sum;
+}
+
+#if !defined(SAL_SSE2_KERNELS) && !defined(SAL_NEON_KERNELS)
+float scalarDot(const float* a, const float* b, size_t size)
+{
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (size_t i = 0; i < size; i += 4)
+    {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i+1] * b[i+1];
+        sum[2] += a[i+2] * b[i+2];
+        sum[3] += a[i+3] * b[i+3];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+#endif
+
+#ifdef SAL_SSE2_KERNELS
+float sse2Dot(const float* a, const float* b, size_t size)
+{
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (size_t i = 0; i < size; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+#ifdef SAL_NEON_KERNELS
+float neonDot(const float* a, const float* b, size_t size)
+{
+    float32x4_t sum0 = vdupq_n_f32(0.0f);
+    float32x4_t sum1 = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < size; i += 8)
+    {
+        sum0 = vfmaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+        sum1 = vfmaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    return vaddvq_f32(vaddq_f32(sum0, sum1));
+}
+#endif
+}
+
+Resampler::Resampler() :
+    m_channels(0),
+    m_interpolation(1),
+    m_decimation(1),
+    m_dot(dotKernel()),
+    m_capacity(0),
+    m_inputFrames(0),
+    m_index(0),
+    m_phase(0)
+{}
+
+void Resampler::configure(int channels, size_t inSampleRate, size_t outSampleRate, ResamplerQuality quality)
+{
+    size_t divisor = std::gcd(inSampleRate, outSampleRate);
+    if (divisor == 0)
+        divisor = 1;
+
+    m_channels = channels;
+    m_interpolation = outSampleRate / divisor;
+    m_decimation = inSampleRate / divisor;
+    if (m_interpolation == 0 || m_decimation == 0)
+        m_interpolation = m_decimation = 1;
+    m_table = filterTable(m_interpolation, m_decimation, quality);
+
+    // The buffers keep the history of one output frame on top of the new frames.
+    m_capacity = RESAMPLER_INPUT_FRAMES + m_table->taps;
+    m_input.assign(m_capacity * channels, 0.0f);
+    reset();
+}
+
+void Resampler::reset()
+{
+    if (!m_table)
+        return;
+
+    // The first output frame is centered on the first input frame, its history is silent.
+    m_inputFrames = m_table->taps / 2 - 1;
+    for (int c = 0; c < m_channels; c++)
+        memset(m_input.data() + c * m_capacity, 0, m_inputFrames * sizeof(float));
+    m_index = 0;
+    m_phase = 0;
+}
+
+void Resampler::commitInput(size_t frames) noexcept
+{
+    m_inputFrames += frames;
+}
+
+void Resampler::flush() noexcept
+{
+    size_t frames = m_table->taps / 2;
+    if (frames > writableFrames())
+        frames = writableFrames();
+    for (int c = 0; c < m_channels; c++)
+        memset(inputChannel(c), 0, frames * sizeof(float));
+    m_inputFrames += frames;
+}
+
+size_t Resampler::inputFramesNeeded(size_t frames) const noexcept
+{
+    if (frames == 0)
+        return 0;
+
+    size_t phases = m_phase + (frames - 1) * m_decimation;
+    size_t framesNeeded = m_index + phases / m_interpolation + m_table->taps;
+    return framesNeeded > m_inputFrames ? framesNeeded - m_inputFrames : 0;
+}
+
+size_t Resampler::process(float* output, size_t frames) noexcept
+{
+    const size_t taps = m_table->taps;
+    const size_t tablePhases = m_table->phases;
+    const float* coefficients = m_table->coefficients.data();
+
+    size_t framesWritten = 0;
+    while (framesWritten < frames && m_index + taps <= m_inputFrames)
+    {
+        // The phase is quantized when the table have less phases than the ratio.
+        size_t phase = tablePhases == m_interpolation ?
+            m_phase : m_phase * tablePhases / m_interpolation;
+        const float* filter = coefficients + phase * taps;
+        const float* input = m_input.data() + m_index;
+
+        for (int c = 0; c < m_channels; c++, input += m_capacity)
+            *output++ = m_dot(filter, input, taps);
+
+        framesWritten++;
+        m_phase += m_decimation;
+        m_index += m_phase / m_interpolation;
+        m_phase %= m_interpolation;
+    }
+
+    compact();
+    return framesWritten;
+}
+
+void Resampler::compact() noexcept
+{
+    size_t dropped = m_index < m_inputFrames ? m_index : m_inputFrames;
+    if (dropped == 0)
+        return;
+
+    for (int c = 0; c < m_channels; c++)
+    {
+        float* channel = m_input.data() + c * m_capacity;
+        memmove(channel, channel + dropped, (m_inputFrames - dropped) * sizeof(float));
+    }
+    m_inputFrames -= dropped;
+    m_index -= dropped;
+}
+
+std::shared_ptr<const Resampler::FilterTable> Resampler::filterTable(
+    size_t interpolation, size_t decimation, ResamplerQuality quality)
+{
+    typedef std::tuple<size_t, size_t, ResamplerQuality> Key;
+    static std::mutex tablesMutex;
+    static std::map<Key, std::shared_ptr<const FilterTable>> tables;
+    static std::map<ResamplerQuality, bool> isCommonComputed;
+
+    std::scoped_lock lock(tablesMutex);
+
+    // The ratios of the common sample rates are ready before the first stream of this quality.
+    if (!isCommonComputed[quality])
+    {
+        for (size_t inSampleRate : COMMON_SAMPLE_RATES)
+        {
+            for (size_t outSampleRate : COMMON_SAMPLE_RATES)
+            {
+                if (inSampleRate == outSampleRate)
+                    continue;
+                size_t divisor = std::gcd(inSampleRate, outSampleRate);
+                Key key(outSampleRate / divisor, inSampleRate / divisor, quality);
+                tables[key] = computeTable(std::get<0>(key), std::get<1>(key), quality);
+            }
+        }
+        isCommonComputed[quality] = true;
+    }
+
+    std::shared_ptr<const FilterTable>& table = tables[Key(interpolation, decimation, quality)];
+    if (!table)
+        table = computeTable(interpolation, decimation, quality);
+    return table;
+}
+
+std::shared_ptr<const Resampler::FilterTable> Resampler::computeTable(
+    size_t interpolation, size_t decimation, ResamplerQuality quality)
+{
+    const double PI = 3.14159265358979323846;
+    const QualityPreset& preset = QUALITY_PRESETS[static_cast<int>(quality)];
+
+    std::shared_ptr<FilterTable> table = std::make_shared<FilterTable>();
+    table->phases = interpolation < RESAMPLER_MAX_PHASES ? interpolation : RESAMPLER_MAX_PHASES;
+
+    // When downsampling, the cutoff is lowered and the filter is longer to keep the same transition band.
+    double cutoff = preset.rolloff;
+    size_t taps = preset.taps;
+    if (decimation > interpolation)
+    {
+        double factor = (double)decimation / interpolation;
+        cutoff /= factor;
+        taps = static_cast<size_t>(std::ceil(taps * factor / 8.0)) * 8;
+        if (taps > RESAMPLER_MAX_TAPS)
+            taps = RESAMPLER_MAX_TAPS;
+    }
+    table->taps = taps;
+    table->coefficients.resize(table->phases * taps);
+
+    const double halfLength = taps / 2.0;
+    const double windowScale = 1.0 / besselI0(preset.beta);
+    for (size_t phase = 0; phase < table->phases; phase++)
+    {
+        float* filter = table->coefficients.data() + phase * taps;
+        double sum = 0.0;
+        for (size_t k = 0; k < taps; k++)
+        {
+            // Distance between the input frame of the tap and the output frame.
+            double t = (double)k - (double)(taps / 2 - 1) - (double)phase / table->phases;
+            double x = t / halfLength;
+            double window = x * x < 1.0 ? besselI0(preset.beta * std::sqrt(1.0 - x * x)) * windowScale : 0.0;
+            double sinc = t == 0.0 ? 1.0 : std::sin(PI * cutoff * t) / (PI * cutoff * t);
+            double coefficient = cutoff * sinc * window;
+            filter[k] = (float)coefficient;
+            sum += coefficient;
+        }
+
+        // Unity gain for each phase.
+        for (size_t k = 0; k < taps; k++)
+            filter[k] = (float)(filter[k] / sum);
+    }
+
+    return table;
+}
+
+Resampler::DotKernel Resampler::dotKernel() noexcept
+{
+#ifdef USE_AVX2_KERNELS
+    if (SampleConverter::isAvailable(SampleConverter::Instructions::AVX2))
+        return ResamplerKernels::avx2Dot;
+#endif
+#ifdef SAL_NEON_KERNELS
+    return neonDot;
+#elif defined(SAL_SSE2_KERNELS)
+    return sse2Dot;
+#else
+    return scalarDot;
+#endif
+}
+}
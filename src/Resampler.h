@@ -0,0 +1,169 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_RESAMPLER_H_
+#define SIMPLE_AUDIO_LIBRARY_RESAMPLER_H_
+
+#include "Common.h"
+#include <cstddef>
+#include <vector>
+#include <memory>
+
+namespace SAL
+{
+/*
+Polyphase windowed-sinc resampler.
+
+The ratio of the sample rates is reduced to L/M: L is the number of
+phases of the filter and the input is moved by M phases per output frame.
+Each phase is a Kaiser windowed sinc of a fixed number of taps, the
+cutoff frequency is lowered when downsampling to avoid aliasing.
+When L is too large, the phases are quantized to RESAMPLER_MAX_PHASES,
+the position stay exact.
+
+The filter tables are shared between the resamplers using the same ratio
+and quality, the tables of the ratios between 44100Hz, 48000Hz and 96000Hz
+are computed the first time a quality is used.
+
+The input is stored per channel, this way each output sample is a
+dot product of two contiguous arrays, computed with the fastest
+instructions set available (SSE2, AVX2 or NEON).
+*/
+class SAL_EXPORT_DLL Resampler
+{
+    Resampler(const Resampler& other) = delete;
+public:
+    typedef float (*DotKernel)(const float* a, const float* b, size_t size);
+
+    Resampler();
+
+    /*
+    Resample *channels channels from *inSampleRate to *outSampleRate
+    with the filter of *quality.
+    */
+    void configure(int channels, size_t inSampleRate, size_t outSampleRate, ResamplerQuality quality);
+
+    /*
+    Forget the input frames and start again with a silent history.
+    */
+    void reset();
+
+    /*
+    Number of input frames that can be written into the input buffers.
+    */
+    inline size_t writableFrames() const noexcept;
+
+    /*
+    Return the position where the next input frames of *channel are written.
+    */
+    inline float* inputChannel(int channel) noexcept;
+
+    /*
+    Distance between the input buffers of two channels.
+    */
+    inline size_t channelStride() const noexcept;
+
+    /*
+    Add *frames frames written into the input buffers.
+    */
+    void commitInput(size_t frames) noexcept;
+
+    /*
+    Append the silence needed to output the last input frames.
+    */
+    void flush() noexcept;
+
+    /*
+    Number of input frames needed to output *frames frames.
+    */
+    size_t inputFramesNeeded(size_t frames) const noexcept;
+
+    /*
+    Write up to *frames interleaved frames into *output
+    from the frames in the input buffers.
+    Return the number of frames written.
+    */
+    size_t process(float* output, size_t frames) noexcept;
+
+    /*
+    Return the number of taps of each phase of the filter.
+    */
+    inline size_t taps() const noexcept;
+
+private:
+    /*
+    Coefficients of every phase, each phase is padded to a multiple of 8 taps.
+    */
+    struct FilterTable
+    {
+        size_t phases;
+        size_t taps;
+        std::vector<float> coefficients;
+    };
+
+    /*
+    Return the shared table of a ratio and quality, computing it if needed.
+    */
+    static std::shared_ptr<const FilterTable> filterTable(size_t interpolation, size_t decimation, ResamplerQuality quality);
+
+    /*
+    Compute the table of a ratio and quality.
+    */
+    static std::shared_ptr<const FilterTable> computeTable(size_t interpolation, size_t decimation, ResamplerQuality quality);
+
+    /*
+    Return the dot product kernel of the fastest instructions set available.
+    */
+    static DotKernel dotKernel() noexcept;
+
+    /*
+    Move the frames still needed at the beginning of the input buffers.
+    */
+    void compact() noexcept;
+
+    int m_channels;
+    // Number of phases (L) and phases moved per output frame (M).
+    size_t m_interpolation;
+    size_t m_decimation;
+    std::shared_ptr<const FilterTable> m_table;
+    DotKernel m_dot;
+
+    // Planar input buffers, m_capacity frames each.
+    std::vector<float> m_input;
+    size_t m_capacity;
+    size_t m_inputFrames;
+    // First input frame of the next output frame and its phase (between 0 and L).
+    size_t m_index;
+    size_t m_phase;
+};
+
+inline size_t Resampler::writableFrames() const noexcept
+{
+    return m_capacity - m_inputFrames;
+}
+
+inline float* Resampler::inputChannel(int channel) noexcept
+{
+    return m_input.data() + channel * m_capacity + m_inputFrames;
+}
+
+inline size_t Resampler::channelStride() const noexcept
+{
+    return m_capacity;
+}
+
+inline size_t Resampler::taps() const noexcept
+{
+    return m_table ? m_table->taps : 0;
+}
+
+/*
+AVX2 dot product kernel, the size is a multiple of 8.
+It is defined in the translation unit compiled with the AVX2 instructions set.
+*/
+namespace ResamplerKernels
+{
+#ifdef USE_AVX2_KERNELS
+float avx2Dot(const float* a, const float* b, size_t size);
+#endif
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_RESAMPLER_H_
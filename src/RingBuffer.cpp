@@ -1,5 +1,13 @@
 #include "RingBuffer.h"
+#include "config.h"
 #include <cstring>
+#include <thread>
+
+#if defined(USE_MIRRORED_RING_BUFFER) && defined(__linux__)
+#define SAL_MIRRORED_RING_BUFFER
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 // Define CLASS_NAME to have the name of the class.
 const std::string CLASS_NAME = "RingBuffer";
@@ -9,120 +17,337 @@ namespace SAL
 RingBuffer::RingBuffer() :
     m_data(nullptr),
     m_size(0),
+    m_mask(0),
+    m_isMirrored(false),
     m_tailPos(0),
     m_headPos(0),
-    m_writeAvailable(0)
+    m_isQuiescing(false),
+    m_activeUsers(0),
+    m_writeReserved(0),
+    m_isWriteReserved(false),
+    m_readReserved(0),
+    m_isReadReserved(false)
 {}
 
 RingBuffer::RingBuffer(size_t bufferSize) :
     m_data(nullptr),
-    m_size(bufferSize),
+    m_size(0),
+    m_mask(0),
+    m_isMirrored(false),
     m_tailPos(0),
     m_headPos(0),
-    m_writeAvailable(bufferSize)
+    m_isQuiescing(false),
+    m_activeUsers(0),
+    m_writeReserved(0),
+    m_isWriteReserved(false),
+    m_readReserved(0),
+    m_isReadReserved(false)
 {
     if (bufferSize > 0)
-        m_data = new char[m_size];
+        allocateStorage(bufferSize);
 }
 
-RingBuffer::RingBuffer(const RingBuffer& other)
+RingBuffer::RingBuffer(const RingBuffer& other) :
+    m_data(nullptr),
+    m_size(0),
+    m_mask(0),
+    m_isMirrored(false),
+    m_isQuiescing(false),
+    m_activeUsers(0),
+    m_writeReserved(0),
+    m_isWriteReserved(false),
+    m_readReserved(0),
+    m_isReadReserved(false)
 {
-    m_size = (size_t)other.m_size;
     m_tailPos = (size_t)other.m_tailPos;
     m_headPos = (size_t)other.m_headPos;
-    m_writeAvailable = (size_t)other.m_writeAvailable;
-    if (other.m_data && m_size > 0)
+    if (other.m_data && other.m_size > 0)
     {
-        m_data = new char[m_size];
+        allocateStorage(other.m_size);
         memcpy(m_data, other.m_data, m_size);
     }
 }
 
 RingBuffer::~RingBuffer()
 {
-    delete[] m_data;
+    releaseStorage();
 }
 
-void RingBuffer::resizeBuffer(size_t bufferSize)
+size_t RingBuffer::storageSize(size_t bufferSize) noexcept
+{
+    // Round up the size to a power of two to wrap the positions with a mask.
+    size_t size = 1;
+    while (size < bufferSize)
+        size <<= 1;
+    return size;
+}
+
+void RingBuffer::allocateStorage(size_t bufferSize)
+{
+    const size_t size = storageSize(bufferSize);
+    if (!allocateMirroredStorage(size))
+    {
+        m_data = new char[size];
+        m_isMirrored = false;
+    }
+    m_size = size;
+    m_mask = size - 1;
+}
+
+bool RingBuffer::allocateMirroredStorage(size_t bufferSize) noexcept
+{
+#ifdef SAL_MIRRORED_RING_BUFFER
+    // The two views must be aligned on pages.
+    long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize <= 0 || bufferSize % (size_t)pageSize != 0)
+        return false;
+
+    int fd = memfd_create("sal-ring-buffer", MFD_CLOEXEC);
+    if (fd == -1)
+        return false;
+
+    if (ftruncate(fd, bufferSize) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // Reserve the address space of both views, then map the same memory into each half.
+    void* address = mmap(nullptr, bufferSize * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+    {
+        close(fd);
+        return false;
+    }
+
+    char* data = static_cast<char*>(address);
+    if (mmap(data, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(data + bufferSize, bufferSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(address, bufferSize * 2);
+        close(fd);
+        return false;
+    }
+
+    // The mappings are keeping the memory alive.
+    close(fd);
+
+    m_data = data;
+    m_isMirrored = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void RingBuffer::releaseStorage() noexcept
 {
-    std::scoped_lock lock(m_readMutex);
+    if (!m_data)
+        return;
+
+#ifdef SAL_MIRRORED_RING_BUFFER
+    if (m_isMirrored)
+        munmap(m_data, m_size * 2);
+    else
+        delete[] m_data;
+#else
     delete[] m_data;
+#endif
+
     m_data = nullptr;
+    m_isMirrored = false;
+    m_size = 0;
+    m_mask = 0;
+}
+
+bool RingBuffer::enter() noexcept
+{
+    // Sequentially consistent, the quiescing thread must either
+    // see the active user or the user must see the quiescing flag.
+    m_activeUsers.fetch_add(1);
+    if (m_isQuiescing.load())
+    {
+        m_activeUsers.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+void RingBuffer::leave() noexcept
+{
+    m_activeUsers.fetch_sub(1, std::memory_order_release);
+}
+
+void RingBuffer::quiesce() noexcept
+{
+    m_isQuiescing.store(true);
+    while (m_activeUsers.load() != 0)
+        std::this_thread::yield();
+}
+
+void RingBuffer::resume() noexcept
+{
+    m_isQuiescing.store(false, std::memory_order_release);
+}
+
+void RingBuffer::resizeBuffer(size_t bufferSize)
+{
+    std::scoped_lock lock(m_quiesceMutex);
+    quiesce();
+
+    releaseStorage();
     if (bufferSize > 0)
+        allocateStorage(bufferSize);
+    m_tailPos = 0;
+    m_headPos = 0;
+
+    resume();
+}
+
+RingBufferSpans RingBuffer::spansAt(size_t pos, size_t size) const noexcept
+{
+    const size_t bufferSize = m_size.load(std::memory_order_relaxed);
+    const size_t index = pos & m_mask;
+    // The storage is mapped a second time after the end, the region never wrap.
+    if (m_isMirrored)
+        return {m_data+index, size, nullptr, 0};
+    else if (size > bufferSize-index)
+        return {m_data+index, bufferSize-index, m_data, size-(bufferSize-index)};
+    else
+        return {m_data+index, size, nullptr, 0};
+}
+
+RingBufferSpans RingBuffer::reserveWrite(size_t size)
+{
+    if (m_isWriteReserved || size == 0 || !enter())
+        return {nullptr, 0, nullptr, 0};
+
+    const size_t bufferSize = m_size.load(std::memory_order_relaxed);
+    // Only the writer is moving the head, the tail is acquired to see the space released.
+    const size_t headPos = m_headPos.load(std::memory_order_relaxed);
+    const size_t tailPos = m_tailPos.load(std::memory_order_acquire);
+
+    // Check if there is space available to write.
+    size_t writeAvailable = bufferSize - (headPos - tailPos);
+    if (!m_data || bufferSize == 0 || writeAvailable == 0)
     {
-        m_size = bufferSize;
-        m_data = new char[m_size];
-        m_tailPos = 0;
-        m_headPos = 0;
-        m_writeAvailable = (size_t)m_size;
+        leave();
+        return {nullptr, 0, nullptr, 0};
     }
+
+    // Get the number in bytes of data to write.
+    if (size > writeAvailable)
+        size = writeAvailable;
+
+    m_writeReserved = size;
+    m_isWriteReserved = true;
+    return spansAt(headPos, size);
 }
 
-size_t RingBuffer::read(char* buffer, size_t size)
+void RingBuffer::commitWrite(size_t size)
 {
-    std::scoped_lock lock(m_readMutex);
+    if (!m_isWriteReserved)
+        return;
+
+    if (size > m_writeReserved)
+        size = m_writeReserved;
+
+    // Move the head position foward, publishing the data to the reader.
+    m_headPos.store(
+        m_headPos.load(std::memory_order_relaxed) + size,
+        std::memory_order_release);
+
+    m_writeReserved = 0;
+    m_isWriteReserved = false;
+    leave();
+}
+
+RingBufferSpans RingBuffer::peekRead(size_t size)
+{
+    if (m_isReadReserved || size == 0 || !enter())
+        return {nullptr, 0, nullptr, 0};
+
+    const size_t bufferSize = m_size.load(std::memory_order_relaxed);
+    // Only the reader is moving the tail, the head is acquired to see the data writen.
+    const size_t tailPos = m_tailPos.load(std::memory_order_relaxed);
+    const size_t headPos = m_headPos.load(std::memory_order_acquire);
+
     // Check if there is data available to read.
-    if (!buffer || !m_data || m_size == 0 || 
-        size == 0 || m_writeAvailable == m_size)
-        return 0;
-    
+    size_t readAvailable = headPos - tailPos;
+    if (!m_data || bufferSize == 0 || readAvailable == 0)
+    {
+        leave();
+        return {nullptr, 0, nullptr, 0};
+    }
+
     // Get the number in bytes of data to read.
-    size_t readAvailable = m_size - m_writeAvailable;
     if (size > readAvailable)
         size = readAvailable;
 
+    m_readReserved = size;
+    m_isReadReserved = true;
+    return spansAt(tailPos, size);
+}
+
+void RingBuffer::consumeRead(size_t size)
+{
+    if (!m_isReadReserved)
+        return;
+
+    if (size > m_readReserved)
+        size = m_readReserved;
+
+    // Move the tail position foward, releasing the space to the writer.
+    m_tailPos.store(
+        m_tailPos.load(std::memory_order_relaxed) + size,
+        std::memory_order_release);
+
+    m_readReserved = 0;
+    m_isReadReserved = false;
+    leave();
+}
+
+size_t RingBuffer::read(char* buffer, size_t size)
+{
+    if (!buffer)
+        return 0;
+
     // Copy data into the output buffer.
-    if (size > m_size-m_tailPos)
-    {
-        size_t lenght = m_size-m_tailPos;
-        memcpy(buffer, m_data+m_tailPos, lenght);
-        memcpy(buffer+lenght, m_data, size-lenght);
-    }
-    else
-        memcpy(buffer, m_data+m_tailPos, size);
-    
-    // Move the tail position foward.
-    m_tailPos = (m_tailPos + size) % m_size;
-    m_writeAvailable += size;
+    RingBufferSpans spans = peekRead(size);
+    if (spans.firstSize > 0)
+        memcpy(buffer, spans.first, spans.firstSize);
+    if (spans.secondSize > 0)
+        memcpy(buffer+spans.firstSize, spans.second, spans.secondSize);
+    consumeRead(spans.size());
 
-    return size;
+    return spans.size();
 }
 
 size_t RingBuffer::write(const char* buffer, size_t size)
 {
-    std::scoped_lock lock(m_readMutex);
-    // Check if there is data to write.
-    if (!buffer || !m_data || m_size == 0 ||
-        size == 0 || m_writeAvailable == 0)
+    if (!buffer)
         return 0;
-    
-    // Get the number in bytes of data to write.
-    if (size > m_writeAvailable)
-        size = m_writeAvailable;
 
     // Copy data from input buffer into the ring buffer.
-    if (size > m_size-m_headPos)
-    {
-        size_t lenght = m_size-m_headPos;
-        memcpy(m_data+m_headPos, buffer, lenght);
-        memcpy(m_data, buffer+lenght, size-lenght);
-    }
-    else
-        memcpy(m_data+m_headPos, buffer, size);
-    
-    // Move the head position foward.
-    m_headPos = (m_headPos + size) % m_size;
-    m_writeAvailable -= size;
+    RingBufferSpans spans = reserveWrite(size);
+    if (spans.firstSize > 0)
+        memcpy(spans.first, buffer, spans.firstSize);
+    if (spans.secondSize > 0)
+        memcpy(spans.second, buffer+spans.firstSize, spans.secondSize);
+    commitWrite(spans.size());
 
-    return size;
+    return spans.size();
 }
 
 void RingBuffer::clear()
 {
-    std::scoped_lock lock(m_readMutex);
-    memset(m_data, 0, m_size);
+    std::scoped_lock lock(m_quiesceMutex);
+    quiesce();
+
+    // Only the positions are reset, the old data is never read again.
     m_tailPos = 0;
     m_headPos = 0;
-    m_writeAvailable = static_cast<size_t>(m_size);
+
+    resume();
 }
 }
\ No newline at end of file
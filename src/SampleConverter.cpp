@@ -0,0 +1,451 @@
+#include "SampleConverter.h"
+#include <cstring>
+#include <cstdint>
+
+#ifdef SAL_SSE2_KERNELS
+#include <emmintrin.h>
+#endif
+#ifdef SAL_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+#if defined(USE_AVX2_KERNELS) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "SampleConverter";
+
+namespace SAL
+{
+namespace
+{
+// Max positive and negative values of the signed integers, as used by the scalar reference.
+const float S8_MAX = (float)0x7F;
+const float S8_MIN = (float)0x80;
+const float S16_MAX = (float)0x7FFF;
+const float S16_MIN = (float)0x8000;
+const float S24_MAX = (float)0x7FFFFF;
+const float S24_MIN = (float)0x800000;
+const float S32_MAX = (float)0x7FFFFFFF;
+const float S32_MIN = (float)0x80000000;
+// Half the max value of an unsigned 8 bits integer.
+const float U8_HALF = 127.5f;
+
+/*
+Scalar reference kernels.
+*/
+
+void scalarU8(const char* input, float* output, size_t samples)
+{
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(input);
+    for (size_t i = 0; i < samples; i++)
+    {
+        output[i] = (float)b[i] / U8_HALF;
+        output[i] -= 1.0f;
+    }
+}
+
+template<typename T>
+void scalarSigned(const char* input, float* output, size_t samples, float max, float min)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        T value;
+        memcpy(&value, input + i * sizeof(T), sizeof(T));
+        float number = (float)value;
+        output[i] = number / (number < 0 ? min : max);
+    }
+}
+
+void scalarS8(const char* input, float* output, size_t samples)
+{
+    scalarSigned<int8_t>(input, output, samples, S8_MAX, S8_MIN);
+}
+
+void scalarS16(const char* input, float* output, size_t samples)
+{
+    scalarSigned<int16_t>(input, output, samples, S16_MAX, S16_MIN);
+}
+
+void scalarS24(const char* input, float* output, size_t samples)
+{
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(input);
+    for (size_t i = 0; i < samples; i++, b += 3)
+    {
+        // Place the 3 bytes in the upper part of a 32 bits integer and shift it back to extend the sign.
+        int32_t value = (int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24) >> 8;
+        float number = (float)value;
+        output[i] = number / (number < 0 ? S24_MIN : S24_MAX);
+    }
+}
+
+void scalarS32(const char* input, float* output, size_t samples)
+{
+    scalarSigned<int32_t>(input, output, samples, S32_MAX, S32_MIN);
+}
+
+void copyF32(const char* input, float* output, size_t samples)
+{
+    memcpy(output, input, samples * sizeof(float));
+}
+
+#ifdef SAL_SSE2_KERNELS
+/*
+SSE2 kernels, 4 samples at a time.
+*/
+
+// Divide by max when positive and by min when negative.
+inline __m128 sse2Scale(__m128 number, __m128 max, __m128 min)
+{
+    __m128 isNegative = _mm_cmplt_ps(number, _mm_setzero_ps());
+    __m128 divisor = _mm_or_ps(_mm_and_ps(isNegative, min), _mm_andnot_ps(isNegative, max));
+    return _mm_div_ps(number, divisor);
+}
+
+void sse2U8(const char* input, float* output, size_t samples)
+{
+    const __m128 half = _mm_set1_ps(U8_HALF);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        __m128i low = _mm_unpacklo_epi8(bytes, zero);
+        __m128i high = _mm_unpackhi_epi8(bytes, zero);
+        __m128i values[4] = {
+            _mm_unpacklo_epi16(low, zero), _mm_unpackhi_epi16(low, zero),
+            _mm_unpacklo_epi16(high, zero), _mm_unpackhi_epi16(high, zero)};
+        for (int j = 0; j < 4; j++)
+        {
+            __m128 number = _mm_div_ps(_mm_cvtepi32_ps(values[j]), half);
+            _mm_storeu_ps(output + i + j * 4, _mm_sub_ps(number, one));
+        }
+    }
+    scalarU8(input + i, output + i, samples - i);
+}
+
+void sse2S8(const char* input, float* output, size_t samples)
+{
+    const __m128 max = _mm_set1_ps(S8_MAX);
+    const __m128 min = _mm_set1_ps(S8_MIN);
+    size_t i = 0;
+    for (; i + 16 <= samples; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        // Sign extend by placing the bytes in the upper part and shifting them back.
+        __m128i low = _mm_srai_epi16(_mm_unpacklo_epi8(bytes, bytes), 8);
+        __m128i high = _mm_srai_epi16(_mm_unpackhi_epi8(bytes, bytes), 8);
+        __m128i values[4] = {
+            _mm_srai_epi32(_mm_unpacklo_epi16(low, low), 16), _mm_srai_epi32(_mm_unpackhi_epi16(low, low), 16),
+            _mm_srai_epi32(_mm_unpacklo_epi16(high, high), 16), _mm_srai_epi32(_mm_unpackhi_epi16(high, high), 16)};
+        for (int j = 0; j < 4; j++)
+            _mm_storeu_ps(output + i + j * 4, sse2Scale(_mm_cvtepi32_ps(values[j]), max, min));
+    }
+    scalarS8(input + i, output + i, samples - i);
+}
+
+void sse2S16(const char* input, float* output, size_t samples)
+{
+    const __m128 max = _mm_set1_ps(S16_MAX);
+    const __m128 min = _mm_set1_ps(S16_MIN);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 2));
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(values, values), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(values, values), 16);
+        _mm_storeu_ps(output + i, sse2Scale(_mm_cvtepi32_ps(low), max, min));
+        _mm_storeu_ps(output + i + 4, sse2Scale(_mm_cvtepi32_ps(high), max, min));
+    }
+    scalarS16(input + i * 2, output + i, samples - i);
+}
+
+void sse2S24(const char* input, float* output, size_t samples)
+{
+    const __m128 max = _mm_set1_ps(S24_MAX);
+    const __m128 min = _mm_set1_ps(S24_MIN);
+    const uint8_t* b = reinterpret_cast<const uint8_t*>(input);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4, b += 12)
+    {
+        // SSE2 have no bytes shuffle, the 3 bytes are placed in the upper part of each 32 bits integer.
+        __m128i values = _mm_set_epi32(
+            (int)((uint32_t)b[9] << 8 | (uint32_t)b[10] << 16 | (uint32_t)b[11] << 24),
+            (int)((uint32_t)b[6] << 8 | (uint32_t)b[7] << 16 | (uint32_t)b[8] << 24),
+            (int)((uint32_t)b[3] << 8 | (uint32_t)b[4] << 16 | (uint32_t)b[5] << 24),
+            (int)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24));
+        values = _mm_srai_epi32(values, 8);
+        _mm_storeu_ps(output + i, sse2Scale(_mm_cvtepi32_ps(values), max, min));
+    }
+    scalarS24(input + i * 3, output + i, samples - i);
+}
+
+void sse2S32(const char* input, float* output, size_t samples)
+{
+    const __m128 max = _mm_set1_ps(S32_MAX);
+    const __m128 min = _mm_set1_ps(S32_MIN);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 4));
+        _mm_storeu_ps(output + i, sse2Scale(_mm_cvtepi32_ps(values), max, min));
+    }
+    scalarS32(input + i * 4, output + i, samples - i);
+}
+#endif
+
+#ifdef SAL_NEON_KERNELS
+/*
+NEON kernels (AArch64 only, ARMv7 have no vector division).
+*/
+
+// Divide by max when positive and by min when negative.
+inline float32x4_t neonScale(float32x4_t number, float32x4_t max, float32x4_t min)
+{
+    uint32x4_t isNegative = vcltq_f32(number, vdupq_n_f32(0.0f));
+    return vdivq_f32(number, vbslq_f32(isNegative, min, max));
+}
+
+void neonU8(const char* input, float* output, size_t samples)
+{
+    const float32x4_t half = vdupq_n_f32(U8_HALF);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        uint16x8_t values = vmovl_u8(vld1_u8(reinterpret_cast<const uint8_t*>(input + i)));
+        float32x4_t low = vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(values))), half);
+        float32x4_t high = vdivq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(values))), half);
+        vst1q_f32(output + i, vsubq_f32(low, one));
+        vst1q_f32(output + i + 4, vsubq_f32(high, one));
+    }
+    scalarU8(input + i, output + i, samples - i);
+}
+
+void neonS8(const char* input, float* output, size_t samples)
+{
+    const float32x4_t max = vdupq_n_f32(S8_MAX);
+    const float32x4_t min = vdupq_n_f32(S8_MIN);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        int16x8_t values = vmovl_s8(vld1_s8(reinterpret_cast<const int8_t*>(input + i)));
+        vst1q_f32(output + i, neonScale(vcvtq_f32_s32(vmovl_s16(vget_low_s16(values))), max, min));
+        vst1q_f32(output + i + 4, neonScale(vcvtq_f32_s32(vmovl_s16(vget_high_s16(values))), max, min));
+    }
+    scalarS8(input + i, output + i, samples - i);
+}
+
+void neonS16(const char* input, float* output, size_t samples)
+{
+    const float32x4_t max = vdupq_n_f32(S16_MAX);
+    const float32x4_t min = vdupq_n_f32(S16_MIN);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        int16x8_t values = vld1q_s16(reinterpret_cast<const int16_t*>(input + i * 2));
+        vst1q_f32(output + i, neonScale(vcvtq_f32_s32(vmovl_s16(vget_low_s16(values))), max, min));
+        vst1q_f32(output + i + 4, neonScale(vcvtq_f32_s32(vmovl_s16(vget_high_s16(values))), max, min));
+    }
+    scalarS16(input + i * 2, output + i, samples - i);
+}
+
+void neonS24(const char* input, float* output, size_t samples)
+{
+    const float32x4_t max = vdupq_n_f32(S24_MAX);
+    const float32x4_t min = vdupq_n_f32(S24_MIN);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        // De-interleave the 3 bytes of 8 samples.
+        uint8x8x3_t bytes = vld3_u8(reinterpret_cast<const uint8_t*>(input + i * 3));
+        uint16x8_t low = vorrq_u16(vmovl_u8(bytes.val[0]), vshlq_n_u16(vmovl_u8(bytes.val[1]), 8));
+        int16x8_t high = vmovl_s8(vreinterpret_s8_u8(bytes.val[2]));
+        int32x4_t values0 = vorrq_s32(
+            vshlq_n_s32(vmovl_s16(vget_low_s16(high)), 16),
+            vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low))));
+        int32x4_t values1 = vorrq_s32(
+            vshlq_n_s32(vmovl_s16(vget_high_s16(high)), 16),
+            vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low))));
+        vst1q_f32(output + i, neonScale(vcvtq_f32_s32(values0), max, min));
+        vst1q_f32(output + i + 4, neonScale(vcvtq_f32_s32(values1), max, min));
+    }
+    scalarS24(input + i * 3, output + i, samples - i);
+}
+
+void neonS32(const char* input, float* output, size_t samples)
+{
+    const float32x4_t max = vdupq_n_f32(S32_MAX);
+    const float32x4_t min = vdupq_n_f32(S32_MIN);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4)
+    {
+        int32x4_t values = vld1q_s32(reinterpret_cast<const int32_t*>(input + i * 4));
+        vst1q_f32(output + i, neonScale(vcvtq_f32_s32(values), max, min));
+    }
+    scalarS32(input + i * 4, output + i, samples - i);
+}
+#endif
+
+#ifdef USE_AVX2_KERNELS
+/*
+Check if the CPU and the OS support AVX2.
+*/
+bool cpuSupportsAVX2() noexcept
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX.
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    // The OS save the YMM registers.
+    if ((_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+}
+
+namespace SampleConverterKernels
+{
+const SampleConverter::Kernel scalar[static_cast<int>(SampleConverter::Format::COUNT)] = {
+    nullptr, scalarU8, scalarS8, scalarS16, scalarS24, scalarS32, copyF32};
+#ifdef SAL_SSE2_KERNELS
+const SampleConverter::Kernel sse2[static_cast<int>(SampleConverter::Format::COUNT)] = {
+    nullptr, sse2U8, sse2S8, sse2S16, sse2S24, sse2S32, copyF32};
+#endif
+#ifdef SAL_NEON_KERNELS
+const SampleConverter::Kernel neon[static_cast<int>(SampleConverter::Format::COUNT)] = {
+    nullptr, neonU8, neonS8, neonS16, neonS24, neonS32, copyF32};
+#endif
+}
+
+SampleConverter::Format SampleConverter::format(SampleType sampleType, int bytesPerSample) noexcept
+{
+    if (sampleType == SampleType::INT)
+    {
+        switch (bytesPerSample)
+        {
+        case 1:
+            return Format::S8;
+        case 2:
+            return Format::S16;
+        case 3:
+            return Format::S24;
+        case 4:
+            return Format::S32;
+        default:
+            return Format::UNKNOWN;
+        }
+    }
+    else if (sampleType == SampleType::UINT && bytesPerSample == 1)
+        return Format::U8;
+    else if (sampleType == SampleType::FLOAT && bytesPerSample == 4)
+        return Format::F32;
+    else
+        return Format::UNKNOWN;
+}
+
+bool SampleConverter::isAvailable(Instructions instructions) noexcept
+{
+    switch (instructions)
+    {
+    case Instructions::SCALAR:
+        return true;
+#ifdef SAL_SSE2_KERNELS
+    case Instructions::SSE2:
+        return true;
+#endif
+#ifdef USE_AVX2_KERNELS
+    case Instructions::AVX2:
+    {
+        static const bool isSupported = cpuSupportsAVX2();
+        return isSupported;
+    }
+#endif
+#ifdef SAL_NEON_KERNELS
+    case Instructions::NEON:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+std::vector<SampleConverter::Instructions> SampleConverter::availableInstructions()
+{
+    std::vector<Instructions> instructionsList;
+    for (Instructions instructions :
+        {Instructions::SCALAR, Instructions::SSE2, Instructions::AVX2, Instructions::NEON})
+    {
+        if (isAvailable(instructions))
+            instructionsList.push_back(instructions);
+    }
+    return instructionsList;
+}
+
+SampleConverter::Instructions SampleConverter::bestInstructions() noexcept
+{
+    if (isAvailable(Instructions::AVX2))
+        return Instructions::AVX2;
+    else if (isAvailable(Instructions::SSE2))
+        return Instructions::SSE2;
+    else if (isAvailable(Instructions::NEON))
+        return Instructions::NEON;
+    else
+        return Instructions::SCALAR;
+}
+
+SampleConverter::Kernel SampleConverter::kernel(Format format, Instructions instructions) noexcept
+{
+    if (format <= Format::UNKNOWN || format >= Format::COUNT || !isAvailable(instructions))
+        return nullptr;
+
+    const int index = static_cast<int>(format);
+    switch (instructions)
+    {
+#ifdef SAL_SSE2_KERNELS
+    case Instructions::SSE2:
+        return SampleConverterKernels::sse2[index];
+#endif
+#ifdef USE_AVX2_KERNELS
+    case Instructions::AVX2:
+        return SampleConverterKernels::avx2[index];
+#endif
+#ifdef SAL_NEON_KERNELS
+    case Instructions::NEON:
+        return SampleConverterKernels::neon[index];
+#endif
+    case Instructions::SCALAR:
+    default:
+        return SampleConverterKernels::scalar[index];
+    }
+}
+
+void SampleConverter::convert(Format format, const char* input, float* output, size_t samples) noexcept
+{
+    // The dispatch is resolved only once.
+    static const Instructions instructions = bestInstructions();
+    convert(format, input, output, samples, instructions);
+}
+
+void SampleConverter::convert(Format format, const char* input, float* output, size_t samples, Instructions instructions) noexcept
+{
+    if (samples == 0 || !input || !output)
+        return;
+
+    Kernel convertKernel = kernel(format, instructions);
+    if (convertKernel)
+        convertKernel(input, output, samples);
+}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_SAMPLECONVERTER_H_
+#define SIMPLE_AUDIO_LIBRARY_SAMPLECONVERTER_H_
+
+#include "Common.h"
+#include <cstddef>
+#include <vector>
+
+namespace SAL
+{
+/*
+Kernels converting raw PCM samples into 32 bits floating point numbers.
+
+Each format have a scalar reference implementation and vectorized
+implementations (SSE2, AVX2 and NEON). The fastest instructions set
+available on the CPU is chosen at runtime. Every implementation
+produce exactly the same result than the scalar reference.
+
+Signed integers are divided by the maximum positive value when positive
+and by the maximum negative value when negative, to get a range of [-1,1].
+Unsigned 8 bits integers are divided by 127.5 and subtracted by 1.
+*/
+class SAL_EXPORT_DLL SampleConverter
+{
+public:
+    /*
+    Instructions set used by the kernels.
+    */
+    enum class Instructions
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+        NEON,
+    };
+
+    /*
+    Raw PCM formats.
+    */
+    enum class Format
+    {
+        UNKNOWN,
+        U8,
+        S8,
+        S16,
+        S24,
+        S32,
+        F32,
+        COUNT,
+    };
+
+    typedef void (*Kernel)(const char* input, float* output, size_t samples);
+
+    /*
+    Return the format of a raw stream based on the sample type
+    and the number of bytes per sample.
+    */
+    static Format format(SampleType sampleType, int bytesPerSample) noexcept;
+
+    /*
+    Convert *samples samples of *input into *output
+    with the fastest instructions set available.
+    */
+    static void convert(Format format, const char* input, float* output, size_t samples) noexcept;
+
+    /*
+    Convert *samples samples of *input into *output
+    with a specific instructions set. Nothing is done
+    if the instructions set is not available.
+    */
+    static void convert(Format format, const char* input, float* output, size_t samples, Instructions instructions) noexcept;
+
+    /*
+    Return true if the instructions set is compiled and supported by the CPU.
+    */
+    static bool isAvailable(Instructions instructions) noexcept;
+
+    /*
+    Return the list of the instructions set available.
+    */
+    static std::vector<Instructions> availableInstructions();
+
+    /*
+    Return the fastest instructions set available.
+    */
+    static Instructions bestInstructions() noexcept;
+
+private:
+    /*
+    Return the kernel of a format for an instructions set,
+    or nullptr if not available.
+    */
+    static Kernel kernel(Format format, Instructions instructions) noexcept;
+};
+
+/*
+Kernels tables indexed by SampleConverter::Format.
+They are defined in the translation unit compiled with the matching instructions set.
+*/
+namespace SampleConverterKernels
+{
+extern const SampleConverter::Kernel scalar[static_cast<int>(SampleConverter::Format::COUNT)];
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAL_SSE2_KERNELS
+extern const SampleConverter::Kernel sse2[static_cast<int>(SampleConverter::Format::COUNT)];
+#endif
+#ifdef USE_AVX2_KERNELS
+extern const SampleConverter::Kernel avx2[static_cast<int>(SampleConverter::Format::COUNT)];
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define SAL_NEON_KERNELS
+extern const SampleConverter::Kernel neon[static_cast<int>(SampleConverter::Format::COUNT)];
+#endif
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_SAMPLECONVERTER_H_
\ No newline at end of file
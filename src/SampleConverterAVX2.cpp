@@ -0,0 +1,115 @@
+#include "SampleConverter.h"
+#include <immintrin.h>
+#include <cstdint>
+#include <cstring>
+
+/*
+This translation unit is compiled with the AVX2 instructions set enabled,
+its kernels are only called after checking the CPU support them.
+*/
+
+namespace SAL
+{
+namespace
+{
+// Divide by max when positive and by min when negative.
+inline __m256 avx2Scale(__m256 number, __m256 max, __m256 min)
+{
+    // The sign bit of the number select the divisor.
+    return _mm256_div_ps(number, _mm256_blendv_ps(max, min, number));
+}
+
+void avx2U8(const char* input, float* output, size_t samples)
+{
+    const __m256 half = _mm256_set1_ps(127.5f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + i));
+        __m256 number = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        _mm256_storeu_ps(output + i, _mm256_sub_ps(_mm256_div_ps(number, half), one));
+    }
+    SampleConverterKernels::scalar[static_cast<int>(SampleConverter::Format::U8)](
+        input + i, output + i, samples - i);
+}
+
+void avx2S8(const char* input, float* output, size_t samples)
+{
+    const __m256 max = _mm256_set1_ps((float)0x7F);
+    const __m256 min = _mm256_set1_ps((float)0x80);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(input + i));
+        __m256 number = _mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(bytes));
+        _mm256_storeu_ps(output + i, avx2Scale(number, max, min));
+    }
+    SampleConverterKernels::scalar[static_cast<int>(SampleConverter::Format::S8)](
+        input + i, output + i, samples - i);
+}
+
+void avx2S16(const char* input, float* output, size_t samples)
+{
+    const __m256 max = _mm256_set1_ps((float)0x7FFF);
+    const __m256 min = _mm256_set1_ps((float)0x8000);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 2));
+        __m256 number = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(values));
+        _mm256_storeu_ps(output + i, avx2Scale(number, max, min));
+    }
+    SampleConverterKernels::scalar[static_cast<int>(SampleConverter::Format::S16)](
+        input + i * 2, output + i, samples - i);
+}
+
+void avx2S24(const char* input, float* output, size_t samples)
+{
+    const __m256 max = _mm256_set1_ps((float)0x7FFFFF);
+    const __m256 min = _mm256_set1_ps((float)0x800000);
+    // Place the 3 bytes of each sample in the upper part of a 32 bits integer.
+    const __m256i shuffle = _mm256_setr_epi8(
+        -128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11,
+        -128, 0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11);
+    size_t i = 0;
+    // Each lane load 16 bytes for 12 used, the loop stop before reading past the input.
+    for (; i + 10 <= samples; i += 8)
+    {
+        const char* p = input + i * 3;
+        __m256i bytes = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+        __m256i values = _mm256_srai_epi32(_mm256_shuffle_epi8(bytes, shuffle), 8);
+        _mm256_storeu_ps(output + i, avx2Scale(_mm256_cvtepi32_ps(values), max, min));
+    }
+    SampleConverterKernels::scalar[static_cast<int>(SampleConverter::Format::S24)](
+        input + i * 3, output + i, samples - i);
+}
+
+void avx2S32(const char* input, float* output, size_t samples)
+{
+    const __m256 max = _mm256_set1_ps((float)0x7FFFFFFF);
+    const __m256 min = _mm256_set1_ps((float)0x80000000);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256i values = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i * 4));
+        _mm256_storeu_ps(output + i, avx2Scale(_mm256_cvtepi32_ps(values), max, min));
+    }
+    SampleConverterKernels::scalar[static_cast<int>(SampleConverter::Format::S32)](
+        input + i * 4, output + i, samples - i);
+}
+
+void copyF32(const char* input, float* output, size_t samples)
+{
+    memcpy(output, input, samples * sizeof(float));
+}
+}
+
+namespace SampleConverterKernels
+{
+const SampleConverter::Kernel avx2[static_cast<int>(SampleConverter::Format::COUNT)] = {
+    nullptr, avx2U8, avx2S8, avx2S16, avx2S24, avx2S32, copyF32};
+}
+}
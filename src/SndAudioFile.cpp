@@ -1,7 +1,6 @@
 #include "SndAudioFile.h"
 #include "DebugLog.h"
 #include <cstring>
-#include <vector>
 
 #ifdef WIN32
 #include "UTFConvertion.h"
@@ -13,14 +12,8 @@ const std::string CLASS_NAME = "SndAudioFile";
 namespace SAL
 {
 SndAudioFile::SndAudioFile(const std::string& filePath) :
-    AbstractAudioFile(filePath),
-    m_file(new SndfileHandle(filePath))
+    AbstractAudioFile(filePath)
 {
-    if (!*m_file.get())
-    {
-        return;
-    }
-
     open();
 }
 
@@ -133,21 +126,20 @@ void SndAudioFile::readDataFromFile()
     if (streamSizeInBytes() == 0 || !m_file || !*m_file.get() || sampleType() != SampleType::FLOAT)
         return;
     
-    // Get the recommended size of the tmp buffer.
-    size_t readSize = minimumSizeTemporaryBuffer();
+    // Get the size of data needed to fill the tmp buffer.
+    size_t readSize = readSizeFromFile();
     if (readPos() + readSize >= streamSizeInBytes())
         readSize = streamSizeInBytes() - readPos();
     
-    // Allocate an array of chars to store the audio data.
-    std::vector<char> data(readSize);
-    memset(data.data(), 0, readSize);
+    // Buffer owned by the file to store the audio data.
+    char* data = rawBuffer(readSize);
 
     // Get the number of items in the sample.
     size_t readItems = readSize / bytesPerSample();
 
     // Retrieve the data from the libsndfile library and listen
     // to the number of bytes read.
-    size_t itemsRead = m_file->read((float*)data.data(), readItems);
+    size_t itemsRead = m_file->read((float*)data, readItems);
 
     // Convert itemsRead to bytes.
     itemsRead *= bytesPerSample();
@@ -155,7 +147,7 @@ void SndAudioFile::readDataFromFile()
     // Push the buffer to the tmp buffer.
     if (itemsRead > 0)
     {
-        insertDataInfoTmpBuffer(data.data(), itemsRead);
+        insertDataInfoTmpBuffer(data, itemsRead);
         incrementReadPos(itemsRead);
     }
 
@@ -0,0 +1,127 @@
+#include "StreamConverter.h"
+#include "AbstractAudioFile.h"
+#include <cstring>
+
+// Maximum number of input frames read from the file at once.
+#define CONVERTER_INPUT_FRAMES 4096
+
+namespace SAL
+{
+StreamConverter::StreamConverter() :
+    m_inChannels(0),
+    m_outChannels(0),
+    m_isResampling(false),
+    m_isFlushed(false)
+{}
+
+void StreamConverter::configure(int inChannels, size_t inSampleRate, int outChannels, size_t outSampleRate,
+    ResamplerQuality quality)
+{
+    m_inChannels = inChannels;
+    m_outChannels = outChannels;
+    m_isResampling = outSampleRate > 0 && inSampleRate != outSampleRate;
+
+    m_readBuffer.assign(CONVERTER_INPUT_FRAMES * inChannels, 0.0f);
+    if (m_isResampling)
+        m_resampler.configure(outChannels, inSampleRate, outSampleRate, quality);
+    reset();
+}
+
+void StreamConverter::reset()
+{
+    m_resampler.reset();
+    m_isFlushed = false;
+}
+
+bool StreamConverter::isDrained() const noexcept
+{
+    return !m_isResampling || (m_isFlushed && m_resampler.inputFramesNeeded(1) > 0);
+}
+
+size_t StreamConverter::readInput(AbstractAudioFile& file, size_t frames)
+{
+    if (frames > m_resampler.writableFrames())
+        frames = m_resampler.writableFrames();
+    if (frames > CONVERTER_INPUT_FRAMES)
+        frames = CONVERTER_INPUT_FRAMES;
+    if (frames == 0)
+        return 0;
+
+    size_t framesRead = file.read(reinterpret_cast<char*>(m_readBuffer.data()), frames);
+    remapChannels(m_readBuffer.data(), framesRead, m_resampler.inputChannel(0), 1, m_resampler.channelStride());
+    m_resampler.commitInput(framesRead);
+    return framesRead;
+}
+
+void StreamConverter::remapChannels(const float* input, size_t frames, float* output,
+    size_t frameStride, size_t channelStride) const
+{
+    for (size_t i = 0; i < frames; i++, input += m_inChannels, output += frameStride)
+    {
+        if (m_inChannels == 1)
+        {
+            for (int c = 0; c < m_outChannels; c++)
+                output[c * channelStride] = input[0];
+        }
+        else if (m_outChannels == 1)
+        {
+            float sum = 0.0f;
+            for (int c = 0; c < m_inChannels; c++)
+                sum += input[c];
+            output[0] = sum / m_inChannels;
+        }
+        else
+        {
+            for (int c = 0; c < m_outChannels; c++)
+                output[c * channelStride] = c < m_inChannels ? input[c] : 0.0f;
+        }
+    }
+}
+
+size_t StreamConverter::process(AbstractAudioFile& file, float* output, size_t frames)
+{
+    size_t framesWritten = 0;
+
+    // Only the channels are remapped, straight into the output.
+    if (!m_isResampling)
+    {
+        while (framesWritten < frames)
+        {
+            size_t framesToRead = frames - framesWritten;
+            if (framesToRead > CONVERTER_INPUT_FRAMES)
+                framesToRead = CONVERTER_INPUT_FRAMES;
+
+            size_t framesRead = file.read(reinterpret_cast<char*>(m_readBuffer.data()), framesToRead);
+            if (framesRead == 0)
+                break;
+            remapChannels(m_readBuffer.data(), framesRead, output + framesWritten * m_outChannels, m_outChannels, 1);
+            framesWritten += framesRead;
+        }
+        return framesWritten;
+    }
+
+    while (true)
+    {
+        framesWritten += m_resampler.process(output + framesWritten * m_outChannels, frames - framesWritten);
+        if (framesWritten == frames)
+            break;
+
+        // Only the input frames needed by the remaining output frames are read.
+        if (readInput(file, m_resampler.inputFramesNeeded(frames - framesWritten)) > 0)
+            continue;
+
+        // The ring buffer is empty and the file is fully read, the last frames are output.
+        if (file.isEndFile() && !m_isFlushed)
+        {
+            m_resampler.flush();
+            m_isFlushed = true;
+            continue;
+        }
+
+        // Buffering or end of the stream.
+        break;
+    }
+
+    return framesWritten;
+}
+}
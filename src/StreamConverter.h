@@ -0,0 +1,88 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_STREAMCONVERTER_H_
+#define SIMPLE_AUDIO_LIBRARY_STREAMCONVERTER_H_
+
+#include "Resampler.h"
+#include <cstddef>
+#include <vector>
+
+namespace SAL
+{
+class AbstractAudioFile;
+
+/*
+Convert the 32 bits floating point stream of a file to the
+format of the output stream, this way files of any format are
+played without recreating the output stream.
+
+The channels are remapped first: mono is copied into every output
+channel, a mono output is the average of the input channels and
+otherwise the extra channels are dropped or left silent. Then the
+stream is resampled by the polyphase resampler.
+
+The frames are pulled from the ring buffer of the file only when
+needed, the converter keep the history of the resampler filter
+between calls. The buffers are allocated by configure, not while
+converting.
+The end of the stream is followed by the silence needed to output
+its last frames.
+*/
+class StreamConverter
+{
+    StreamConverter(const StreamConverter& other) = delete;
+public:
+    StreamConverter();
+
+    /*
+    Convert a stream of *inChannels at *inSampleRate to *outChannels at *outSampleRate
+    with the resampler of *quality.
+    */
+    void configure(int inChannels, size_t inSampleRate, int outChannels, size_t outSampleRate,
+        ResamplerQuality quality);
+
+    /*
+    Forget the frames kept from the previous calls.
+    */
+    void reset();
+
+    /*
+    Read frames from *file and write up to *frames frames
+    in the output format into *output.
+    Return the number of frames written.
+    */
+    size_t process(AbstractAudioFile& file, float* output, size_t frames);
+
+    /*
+    Return true if every frame read from the end of the stream is written.
+    */
+    bool isDrained() const noexcept;
+
+private:
+    /*
+    Read up to *frames frames from *file and append them
+    remapped to the output channels into the resampler.
+    Return the number of frames read.
+    */
+    size_t readInput(AbstractAudioFile& file, size_t frames);
+
+    /*
+    Remap the channels of *frames frames from *input into *output.
+    The samples of a channel are *frameStride apart and the channels
+    are *channelStride apart.
+    */
+    void remapChannels(const float* input, size_t frames, float* output,
+        size_t frameStride, size_t channelStride) const;
+
+    int m_inChannels;
+    int m_outChannels;
+    // Only the channels are remapped when the sample rates are the same.
+    bool m_isResampling;
+    // The silence after the end of the stream is in the resampler.
+    bool m_isFlushed;
+
+    // Frames read from the file, in the input format.
+    std::vector<float> m_readBuffer;
+    Resampler m_resampler;
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_STREAMCONVERTER_H_
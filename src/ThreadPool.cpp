@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+
+namespace SAL
+{
+namespace
+{
+// Pool and index of the worker running on this thread.
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentWorker = 0;
+}
+
+ThreadPool::ThreadPool(int threadCount) :
+    m_nextWorker(0),
+    m_queuedTasks(0),
+    m_isStopping(false)
+{
+    if (threadCount <= 0)
+        threadCount = static_cast<int>(std::thread::hardware_concurrency());
+    if (threadCount <= 0)
+        threadCount = 1;
+
+    // The queues are created before the threads, a worker may steal from any of them.
+    for (int i = 0; i < threadCount; i++)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (size_t i = 0; i < m_workers.size(); i++)
+        m_workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock lock(m_sleepMutex);
+        m_isStopping = true;
+    }
+    m_sleepCV.notify_all();
+
+    for (std::unique_ptr<Worker>& worker : m_workers)
+        worker->thread.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+    size_t index;
+    if (currentPool == this)
+        index = currentWorker;
+    else
+        index = m_nextWorker.fetch_add(1, std::memory_order_relaxed) % m_workers.size();
+
+    {
+        std::scoped_lock lock(m_workers[index]->mutex);
+        m_workers[index]->tasks.push_back(std::move(task));
+        // Counted under the mutex of the queue, before any worker can take it.
+        m_queuedTasks.fetch_add(1);
+    }
+
+    // The mutex is locked to be sure a worker checking the queues is either before or inside the wait.
+    {
+        std::scoped_lock lock(m_sleepMutex);
+    }
+    m_sleepCV.notify_one();
+}
+
+bool ThreadPool::takeTask(size_t index, Task& task)
+{
+    // The newest task of the own queue.
+    {
+        Worker& worker = *m_workers[index];
+        std::scoped_lock lock(worker.mutex);
+        if (!worker.tasks.empty())
+        {
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            m_queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    // The oldest task of another queue.
+    for (size_t i = 1; i < m_workers.size(); i++)
+    {
+        Worker& victim = *m_workers[(index + i) % m_workers.size()];
+        std::scoped_lock lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queuedTasks.fetch_sub(1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(size_t index)
+{
+    currentPool = this;
+    currentWorker = index;
+
+    while (true)
+    {
+        Task task;
+        if (takeTask(index, task))
+        {
+            task();
+            continue;
+        }
+
+        std::unique_lock lock(m_sleepMutex);
+        m_sleepCV.wait(lock, [this]() { return m_queuedTasks.load() > 0 || m_isStopping.load(); });
+        if (m_isStopping && m_queuedTasks.load() == 0)
+            break;
+    }
+
+    currentPool = nullptr;
+}
+}
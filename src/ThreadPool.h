@@ -0,0 +1,85 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_THREADPOOL_H_
+#define SIMPLE_AUDIO_LIBRARY_THREADPOOL_H_
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace SAL
+{
+/*
+Pool of worker threads with work stealing.
+
+Each worker have its own queue of tasks. A task submitted from a
+worker go into the queue of this worker, the other tasks are spread
+between the queues. A worker take the newest task of its queue (the
+data it just used is still in the cache) and, when its queue is empty,
+steal the oldest task of another queue. This way long and short tasks
+are balanced between the workers without a single shared queue.
+When no task is available, the workers are sleeping.
+*/
+class ThreadPool
+{
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+public:
+    typedef std::function<void()> Task;
+
+    /*
+    Start *threadCount workers, 0 for one per hardware thread.
+    */
+    ThreadPool(int threadCount = 0);
+
+    /*
+    Run the remaining tasks and stop the workers.
+    */
+    ~ThreadPool();
+
+    /*
+    Add a task to run on a worker.
+    */
+    void submit(Task task);
+
+    inline int threadCount() const noexcept;
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    void workerLoop(size_t index);
+
+    /*
+    Take a task from the queue of the worker *index
+    or steal one from another worker.
+    */
+    bool takeTask(size_t index, Task& task);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    // Queue receiving the next task submitted from outside the pool.
+    std::atomic<size_t> m_nextWorker;
+    // Number of tasks in the queues.
+    std::atomic<size_t> m_queuedTasks;
+
+    // Sleeping workers.
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCV;
+    std::atomic<bool> m_isStopping;
+};
+
+inline int ThreadPool::threadCount() const noexcept
+{
+    return static_cast<int>(m_workers.size());
+}
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_THREADPOOL_H_
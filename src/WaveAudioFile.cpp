@@ -1,7 +1,8 @@
 #include "WaveAudioFile.h"
 #include "DebugLog.h"
 #include <cstring>
-#include <vector>
+#include <cstdint>
+#include <limits>
 
 #ifdef WIN32
 #include "UTFConvertion.h"
@@ -12,6 +13,99 @@ const std::string CLASS_NAME = "WaveAudioFile";
 
 namespace SAL
 {
+namespace
+{
+// Format tags of the fmt chunk.
+const uint16_t WAVE_FORMAT_PCM = 0x0001;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+const uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+// Last 14 bytes of the KSDATAFORMAT_SUBTYPE GUIDs, the first 2 bytes are the format tag.
+const unsigned char WAVE_SUBFORMAT_GUID_TAIL[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+// Read a little endian unsigned integer.
+template<typename T>
+T readLittleEndian(const char* data)
+{
+    T value = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+        value |= (T)(uint8_t)data[i] << (i * 8);
+    return value;
+}
+
+/*
+Header of a chunk of a RIFF file.
+*/
+struct RiffChunk
+{
+    char id[4];
+    uint64_t size;
+    // Position of the data of the chunk in the file.
+    uint64_t dataPos;
+};
+
+/*
+Walk the chunks of a RIFF file one after the other.
+The chunks are word aligned, the padding byte of the
+odd sized chunks is skipped.
+*/
+class RiffChunkIterator
+{
+public:
+    RiffChunkIterator(std::istream& stream, uint64_t start, uint64_t end) :
+        m_stream(stream),
+        m_nextPos(start),
+        m_end(end),
+        m_dataSize(0),
+        m_hasDataSize(false)
+    {}
+
+    /*
+    Read the header of the next chunk and move the stream
+    to its data. Return false if there is no more chunks.
+    */
+    bool next(RiffChunk& chunk)
+    {
+        if (m_nextPos + 8 > m_end)
+            return false;
+
+        char header[8];
+        m_stream.clear();
+        m_stream.seekg(m_nextPos);
+        if (!m_stream.read(header, 8))
+            return false;
+
+        memcpy(chunk.id, header, 4);
+        chunk.size = readLittleEndian<uint32_t>(header+4);
+        chunk.dataPos = m_nextPos + 8;
+
+        // The size of the data chunk of the RF64/BW64 files is in the ds64 chunk.
+        if (m_hasDataSize && chunk.size == 0xFFFFFFFF && memcmp(chunk.id, "data", 4) == 0)
+            chunk.size = m_dataSize;
+
+        m_nextPos = chunk.dataPos + chunk.size + (chunk.size & 1);
+        return true;
+    }
+
+    /*
+    Set the 64 bits size of the data chunk read from the ds64 chunk.
+    */
+    void setDataSize(uint64_t size)
+    {
+        m_dataSize = size;
+        m_hasDataSize = true;
+    }
+
+private:
+    std::istream& m_stream;
+    uint64_t m_nextPos;
+    uint64_t m_end;
+    uint64_t m_dataSize;
+    bool m_hasDataSize;
+};
+}
+
 /*
 Opening a file *filePath and prepare it
 for streaming.
@@ -22,6 +116,20 @@ WaveAudioFile::WaveAudioFile(const std::string& filePath) :
     open();
 }
 
+WaveAudioFile::WaveAudioFile(const std::string& filePath, std::ifstream&& file) :
+    AbstractAudioFile(filePath),
+    m_audioFile(std::move(file))
+{
+    open();
+}
+
+WaveAudioFile::WaveAudioFile(const std::string& filePath, MappedFile&& mappedFile) :
+    AbstractAudioFile(filePath),
+    m_mappedFile(std::move(mappedFile))
+{
+    open();
+}
+
 WaveAudioFile::~WaveAudioFile()
 {
     close();
@@ -34,289 +142,246 @@ void WaveAudioFile::open()
     if (filePath().empty())
         return;
     
+    // The file may have been mapped or opened by the format probe, otherwise it is mapped if possible.
+    if (!m_mappedFile.isMapped() && !m_audioFile.is_open() && !m_mappedFile.map(filePath()))
+    {
 #ifdef WIN32
-    m_audioFile.open(UTFConvertion::toWString(filePath()), std::fstream::binary);
+        m_audioFile.open(UTFConvertion::toWString(filePath()), std::fstream::binary);
 #else
-    m_audioFile.open(filePath(), std::fstream::binary);
+        m_audioFile.open(filePath(), std::fstream::binary);
 #endif
-    if (m_audioFile.is_open())
+    }
+    if (!m_mappedFile.isMapped() && !m_audioFile.is_open())
     {
-        // RIFF identifier.
-        char RIFF[5] = {0, 0, 0, 0, 0};
-        m_audioFile.read(RIFF, 4);
-        if (strcmp(RIFF, "RIFF") != 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: RIFF identifier not available")
-
-            return;
-        }
-        
-        unsigned int fileSize = 0;
-        m_audioFile.read((char*)&fileSize, 4);
-        if (fileSize == 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid file size")
-
-            return;
-        }
-        
-        // WAVE identifier.
-        char WAVE[5] = {0, 0, 0, 0, 0};
-        m_audioFile.read(WAVE, 4);
-        if (strcmp(WAVE, "WAVE") != 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: WAVE indentifier not available")
+        SAL_DEBUG_OPEN_FILE("Failed to open file: cannot open file")
 
-            return;
-        }
-        
-        // "fmt " identifier.
-        char fmt_[5] = {0, 0, 0, 0, 0};
-        m_audioFile.read(fmt_, 4);
-        if (strcmp(fmt_, "fmt ") != 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: \"fmt \" identifier not available")
+        return;
+    }
 
-            return;
-        }
-        
-        // "fmt " size.
-        int fmt_size = 0;
-        m_audioFile.read((char*)&fmt_size, 4);
-        if (fmt_size != 16 && fmt_size != 18 
-            && fmt_size != 40 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid fmt_size section")
+    // The headers are read from the mapped file, or from the file stream.
+    MemoryStreamBuffer mappedBuffer(m_mappedFile.data(), m_mappedFile.size());
+    std::istream mappedStream(&mappedBuffer);
+    std::istream& stream = m_mappedFile.isMapped() ? mappedStream : m_audioFile;
 
-            return;
-        }
-        
-        // PCM format
-        unsigned short pcmFormat = 0;
-        m_audioFile.read((char*)&pcmFormat, 2);
-        if ((pcmFormat != 1 && pcmFormat != 65534) || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid pcm format")
+    // Size of the file, the chunks cannot go past it.
+    stream.seekg(0, std::ios::end);
+    const std::streamoff fileSize = stream.tellg();
+    stream.seekg(0, std::ios::beg);
+    if (fileSize < 12 || stream.fail())
+    {
+        SAL_DEBUG_OPEN_FILE("Failed to open file: file too small")
 
-            return;
-        }
-        
-        // Channels
-        short channels = 0;
-        m_audioFile.read((char*)&channels, 2);
-        if (channels < 1 && channels > 6 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid channels number")
+        return;
+    }
 
-            return;
-        }
-        
-        // Sample rate
-        int sampleRate = 0;
-        m_audioFile.read((char*)&sampleRate, 4);
-        if (sampleRate <= 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid sample rate")
+    // RIFF, RF64 or BW64 identifier, followed by the size and the WAVE identifier.
+    char header[12];
+    stream.read(header, 12);
+    if (stream.fail() || memcmp(header+8, "WAVE", 4) != 0)
+    {
+        SAL_DEBUG_OPEN_FILE("Failed to open file: WAVE indentifier not available")
 
-            return;
-        }
-        
-        // Passing 4 bytes
-        int dummyInteger;
-        m_audioFile.read((char*)&dummyInteger, 4);
-        if (m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file")
+        return;
+    }
 
-            return;
-        }
-        
-        // Passing 2 bytes.
-        m_audioFile.read((char*)&dummyInteger, 2);
-        if (m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file")
+    bool is64 = false;
+    if (memcmp(header, "RF64", 4) == 0 || memcmp(header, "BW64", 4) == 0)
+        is64 = true;
+    else if (memcmp(header, "RIFF", 4) != 0)
+    {
+        SAL_DEBUG_OPEN_FILE("Failed to open file: RIFF identifier not available")
 
-            return;
-        }
-        
-        // Bits per sample
-        short bitsPerSample = 0;
-        m_audioFile.read((char*)&bitsPerSample, 2);
-        if (bitsPerSample != 8 && bitsPerSample != 16 && 
-            bitsPerSample != 24 && bitsPerSample != 32 ||
-            m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid bits per sample")
+        return;
+    }
 
-            return;
-        }
+    RiffChunkIterator chunks(stream, 12, fileSize);
+    RiffChunk chunk;
+    WaveFormat format;
+    bool isFormatFound = false;
+    bool isDataFound = false;
+    uint64_t dataStart = 0;
+    uint64_t dataSize = 0;
 
-        SAL_DEBUG_OPEN_FILE(std::string("bits per sample: ") + std::to_string(bitsPerSample))
-        
-        // Read extra bytes.
-        if (fmt_size == 18 || fmt_size == 40)
+    // Walk the chunks until the data chunk, unknown chunks are skipped.
+    while (!isDataFound && chunks.next(chunk))
+    {
+        if (memcmp(chunk.id, "ds64", 4) == 0 && is64)
         {
-            std::vector<char> extraBytes(fmt_size-16);
-            m_audioFile.read(extraBytes.data(), fmt_size-16);
-            if (m_audioFile.fail())
+            // The 64 bits sizes of the RF64/BW64 files: RIFF size, data size and samples count.
+            char ds64[24];
+            if (chunk.size < 24 || !stream.read(ds64, 24))
             {
-                SAL_DEBUG_OPEN_FILE("Failed to open file")
+                SAL_DEBUG_OPEN_FILE("Failed to open file: invalid ds64 chunk")
 
                 return;
             }
+            chunks.setDataSize(readLittleEndian<uint64_t>(ds64+8));
         }
-
-        // Next identifier
-        char nextIdentifier[5] = {0, 0, 0, 0, 0};
-        m_audioFile.read(nextIdentifier, 4);
-        if (m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: failed to read next identifier, not valid WAVE file")
-
-            return;
-        }
-        
-        bool isFloatStream = false;
-
-        // Read "fact" section if available.
-        if (strcmp(nextIdentifier, "fact") == 0)
+        else if (memcmp(chunk.id, "fmt ", 4) == 0)
         {
-            // "fact" size.
-            int factSize = 0;
-            m_audioFile.read((char*)&factSize, 4);
-            if (factSize <= 0 || m_audioFile.fail())
+            if (!readFormat(stream, chunk.size, format))
             {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: invalid fact size")
-
-                return;
-            }
-            
-            // Reading the fact section without processing it.
-            std::vector<char> factData(factSize);
-            memset(factData.data(), 0, factSize);
-            m_audioFile.read(factData.data(), factSize);
-            if (m_audioFile.fail())
-            {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: cannot read fact data")
-
-                return;
-            }
-            
-            // The "fact" section mean the wave file is a float stream.
-            isFloatStream = true;
-
-            SAL_DEBUG_OPEN_FILE("Floating point PCM data")
-            
-            // Read the identifier of the next section.
-            m_audioFile.read(nextIdentifier, 4);
-            if (m_audioFile.fail())
-            {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: failed to read next identifier, not valid WAVE file")
+                SAL_DEBUG_OPEN_FILE("Failed to open file: invalid fmt chunk")
 
                 return;
             }
+            isFormatFound = true;
         }
-        
-        // If next identifier is "LIST" identifier.
-        if (strcmp(nextIdentifier, "LIST") == 0)
+        else if (memcmp(chunk.id, "data", 4) == 0)
         {
-            // "LIST" size.
-            int listSize = 0;
-            m_audioFile.read((char*)&listSize, 4);
-            if (listSize <= 0 || m_audioFile.fail())
-            {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: invalid LIST size")
+            dataStart = chunk.dataPos;
+            dataSize = chunk.size;
+            isDataFound = true;
+        }
+        else
+        {
+            SAL_DEBUG_OPEN_FILE(std::string("Skipping chunk ") + std::string(chunk.id, 4))
+        }
+    }
 
-                return;
-            }
-            
-            // Read track name.
-            std::vector<char> trackName(listSize+1);
-            memset(trackName.data(), 0, listSize+1);
-            m_audioFile.read(trackName.data(), listSize);
-            if (m_audioFile.fail())
-            {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: failed to read LIST data (track name)")
+    if (!isFormatFound || !isDataFound)
+    {
+        SAL_DEBUG_OPEN_FILE("Failed to open file: no fmt or data chunk, invalid WAVE file")
 
-                return;
-            }
-            
-            // Read "data" identifier into nextIdentifier.
-            m_audioFile.read(nextIdentifier, 4);
-            if (m_audioFile.fail())
-            {
-                SAL_DEBUG_OPEN_FILE("Failed to open file: failed to read next identifier, invalid WAVE file")
+        return;
+    }
 
-                return;
-            }
-        }
-        else
-            return;
+    SAL_DEBUG_OPEN_FILE(std::string("bits per sample: ") + std::to_string(format.bitsPerSample))
 
-        // "data" identifier.
-        if (strcmp(nextIdentifier, "data") != 0 || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: no data section, invalid WAVE file")
+    if (!isFormatSupported(format))
+    {
+        SAL_DEBUG_OPEN_FILE("Failed to open file: invalid pcm format type")
 
-            return;
-        }
-        
-        // Audio file size in bytes.
-        unsigned int audioDataSize = 0;
-        m_audioFile.read((char*)&audioDataSize, 4);
-        if (audioDataSize == 0 || audioDataSize > fileSize || m_audioFile.fail())
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid data size")
+        return;
+    }
 
-            return;
-        }
-        
-        // PCM format
-        SampleType pcmFormatType;
-        if (!isFloatStream)
-        {
-            if (bitsPerSample > 8)
-                pcmFormatType = SampleType::INT;
-            else
-                pcmFormatType = SampleType::UINT;
-        }
-        else if (bitsPerSample == 32)
-            pcmFormatType = SampleType::FLOAT;
-        else
-        {
-            SAL_DEBUG_OPEN_FILE("Failed to open file: invalid pcm format type")
+    // PCM format
+    SampleType pcmFormatType;
+    if (format.formatTag == WAVE_FORMAT_IEEE_FLOAT)
+    {
+        pcmFormatType = SampleType::FLOAT;
 
-            return;
-        }
-        
-        // Then the data will be streamed.
-
-        // Store headers data.
-        setNumChannels(channels);
-        setSampleRate(sampleRate);
-        setBytesPerSample(bitsPerSample/8);
-        setSizeStream(audioDataSize);
-        setDataStartingPoint(m_audioFile.tellg());
-        updateBuffersSize();
-        setSampleType(pcmFormatType);
-        fileOpened();
+        SAL_DEBUG_OPEN_FILE("Floating point PCM data")
     }
-#ifndef NDEBUG
+    else if (format.bitsPerSample > 8)
+        pcmFormatType = SampleType::INT;
     else
+        pcmFormatType = SampleType::UINT;
+
+    /*
+    Some recorders leave the data size unset (0 or 0xFFFFFFFF) until they are done,
+    the data then goes until the end of the file. Only whole frames are streamed.
+    */
+    const uint64_t bytesPerFrame = format.channels * (format.bitsPerSample / 8);
+    if (dataSize == 0 || dataStart + dataSize > (uint64_t)fileSize)
+        dataSize = (uint64_t)fileSize - dataStart;
+    dataSize = dataSize / bytesPerFrame * bytesPerFrame;
+    if (dataSize == 0 || dataSize > std::numeric_limits<size_t>::max())
     {
-        SAL_DEBUG_OPEN_FILE("Failed to open file: cannot open file")
+        SAL_DEBUG_OPEN_FILE("Failed to open file: invalid data size")
+
         return;
     }
-#endif
+
+    // Then the data will be streamed.
+    if (!m_mappedFile.isMapped())
+    {
+        m_audioFile.clear();
+        m_audioFile.seekg(dataStart);
+    }
+
+    // Store headers data.
+    setNumChannels(format.channels);
+    setSampleRate(format.sampleRate);
+    setBytesPerSample(format.bitsPerSample/8);
+    setSizeStream(dataSize);
+    setDataStartingPoint(dataStart);
+    updateBuffersSize();
+    setSampleType(pcmFormatType);
+
+    // The data of the mapped file is converted directly from the page cache.
+    if (m_mappedFile.isMapped())
+    {
+        m_mappedFile.adviseSequential();
+        m_mappedFile.prefetch(dataStartingPoint(), minimumSizeTemporaryBuffer());
+
+        SAL_DEBUG_OPEN_FILE("File mapped in memory")
+    }
+
+    fileOpened();
 
     SAL_DEBUG_OPEN_FILE("Opening file done")
 }
 
+bool WaveAudioFile::isReadable(std::istream& stream)
+{
+    const std::streamoff start = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    const std::streamoff end = stream.tellg();
+    stream.seekg(start);
+
+    char header[12];
+    if (start < 0 || end < start + 12 || !stream.read(header, 12) || memcmp(header+8, "WAVE", 4) != 0)
+        return false;
+
+    // The fmt chunk is before the data chunk.
+    RiffChunkIterator chunks(stream, start + 12, end);
+    RiffChunk chunk;
+    while (chunks.next(chunk))
+    {
+        if (memcmp(chunk.id, "fmt ", 4) == 0)
+        {
+            WaveFormat format;
+            return readFormat(stream, chunk.size, format) && isFormatSupported(format);
+        }
+        if (memcmp(chunk.id, "data", 4) == 0)
+            return false;
+    }
+    return false;
+}
+
+bool WaveAudioFile::readFormat(std::istream& stream, uint64_t size, WaveFormat& format)
+{
+    // The basic PCM format is 16 bytes, WAVE_FORMAT_EXTENSIBLE is 40 bytes.
+    char fmt[40];
+    if (size < 16)
+        return false;
+    size_t readSize = size < 40 ? (size_t)size : 40;
+    if (!stream.read(fmt, readSize))
+        return false;
+
+    format.formatTag = readLittleEndian<uint16_t>(fmt);
+    format.channels = readLittleEndian<uint16_t>(fmt+2);
+    format.sampleRate = readLittleEndian<uint32_t>(fmt+4);
+    format.blockAlign = readLittleEndian<uint16_t>(fmt+12);
+    format.bitsPerSample = readLittleEndian<uint16_t>(fmt+14);
+
+    // The real format is the sub-format, the first 2 bytes of the GUID.
+    if (format.formatTag == WAVE_FORMAT_EXTENSIBLE)
+    {
+        if (readSize < 40 || memcmp(fmt+26, WAVE_SUBFORMAT_GUID_TAIL, sizeof(WAVE_SUBFORMAT_GUID_TAIL)) != 0)
+            return false;
+        format.formatTag = readLittleEndian<uint16_t>(fmt+24);
+    }
+
+    return format.channels > 0 &&
+        format.sampleRate > 0 &&
+        (format.bitsPerSample == 8 || format.bitsPerSample == 16 ||
+        format.bitsPerSample == 24 || format.bitsPerSample == 32) &&
+        format.blockAlign == format.channels * (format.bitsPerSample / 8);
+}
+
+bool WaveAudioFile::isFormatSupported(const WaveFormat& format)
+{
+    return format.formatTag == WAVE_FORMAT_PCM ||
+        (format.formatTag == WAVE_FORMAT_IEEE_FLOAT && format.bitsPerSample == 32);
+}
+
 void WaveAudioFile::close()
 {
     SAL_DEBUG_OPEN_FILE("Closing file")
 
+    m_mappedFile.unmap();
     if (m_audioFile.is_open())
         m_audioFile.close();
 }
@@ -324,21 +389,32 @@ void WaveAudioFile::close()
 void WaveAudioFile::readDataFromFile()
 {
     // Check if the file is open and there is data to read.
-    if (!m_audioFile.is_open() || streamSizeInBytes() == 0)
+    if ((!m_mappedFile.isMapped() && !m_audioFile.is_open()) || streamSizeInBytes() == 0)
         return;
 
     SAL_DEBUG_READ_FILE("Reading data from file")
     
-    // Get the size of the tmp buffer.
-    size_t readSize = minimumSizeTemporaryBuffer();
+    // Get the size of data needed to fill the tmp buffer.
+    size_t readSize = readSizeFromFile();
     if (readPos() + readSize > streamSizeInBytes())
         readSize = streamSizeInBytes() - readPos();
+
+    // The data is converted directly from the mapped file.
+    if (m_mappedFile.isMapped())
+    {
+        insertDataInfoTmpBuffer(m_mappedFile.data() + dataStartingPoint() + readPos(), readSize);
+        incrementReadPos(readSize);
+
+        // Ask the kernel to load the next block while this one is played.
+        m_mappedFile.prefetch(dataStartingPoint() + readPos(), readSize);
+
+        SAL_DEBUG_READ_FILE("Reading data from file done")
+        return;
+    }
     
     // Get data from file.
-    std::vector<char> data(readSize);
-    memset(data.data(), 0, readSize);
-
-    m_audioFile.read(data.data(), readSize);
+    char* data = rawBuffer(readSize);
+    m_audioFile.read(data, readSize);
 
     if (m_audioFile.fail())
     {
@@ -347,7 +423,7 @@ void WaveAudioFile::readDataFromFile()
     }
 
     // Send data into the tmp buffer.
-    insertDataInfoTmpBuffer(data.data(), readSize);
+    insertDataInfoTmpBuffer(data, readSize);
     incrementReadPos(readSize);
 
     SAL_DEBUG_READ_FILE("Reading data from file done")
@@ -359,6 +435,16 @@ bool WaveAudioFile::updateReadingPos(size_t pos)
 
     // Pos in bytes.
     pos *= bytesPerSample() * numChannels();
+
+    // The mapped data is read from the reading position, only the data ahead is prefetched.
+    if (m_mappedFile.isMapped())
+    {
+        if (pos > streamSizeInBytes())
+            return false;
+        m_mappedFile.prefetch(dataStartingPoint() + pos, minimumSizeTemporaryBuffer());
+        return true;
+    }
+
     // Headers offset.
     pos += dataStartingPoint();
 
@@ -2,12 +2,19 @@
 #define SIMPLE_AUDIO_LIBRARY_WAVE_AUDIO_FILE_H_
 
 #include "AbstractAudioFile.h"
+#include "MappedFile.h"
 #include <fstream>
+#include <cstdint>
 
 namespace SAL
 {
 /*
 Interface to stream a Wave audio file.
+
+On POSIX systems, the file is mapped in memory and the PCM data
+is converted directly from the page cache, seeking is only moving
+the reading position. If the file cannot be mapped (not a regular
+file, mapping failed), the data is read with the ifstream.
 */
 class SAL_EXPORT_DLL WaveAudioFile : public AbstractAudioFile
 {
@@ -18,8 +25,28 @@ public:
     for streaming.
     */
     WaveAudioFile(const std::string& filePath);
+
+    /*
+    Prepare the file *filePath for streaming
+    with the file handle *file already opened.
+    */
+    WaveAudioFile(const std::string& filePath, std::ifstream&& file);
+
+    /*
+    Prepare the file *filePath for streaming
+    with the file *mappedFile already mapped.
+    */
+    WaveAudioFile(const std::string& filePath, MappedFile&& mappedFile);
     virtual ~WaveAudioFile();
 
+    /*
+    Return true if the samples of the WAVE file read by *stream can be
+    decoded by this reader (integer PCM or 32 bits floating point).
+    The chunks are walked until the fmt chunk, the stream must be at
+    the start of the RIFF header.
+    */
+    static bool isReadable(std::istream& stream);
+
 protected:
     /*
     Read from the audio file and put it into
@@ -36,17 +63,46 @@ protected:
 
 private:
     /*
-    Open the Wave file and read all the headers.
+    Information of the fmt chunk.
+    */
+    struct WaveFormat
+    {
+        uint16_t formatTag;
+        uint16_t channels;
+        uint32_t sampleRate;
+        uint16_t blockAlign;
+        uint16_t bitsPerSample;
+    };
+
+    /*
+    Open the Wave file (RIFF, RF64 or BW64) and walk the chunks
+    until the data chunk. Unknown chunks are skipped.
     */
     void open();
 
+    /*
+    Read the fmt chunk of *size bytes at the current position of *stream.
+    With WAVE_FORMAT_EXTENSIBLE, the format tag is taken from the sub-format.
+    Return false if the format is not valid.
+    */
+    static bool readFormat(std::istream& stream, uint64_t size, WaveFormat& format);
+
+    /*
+    Return true if the samples of *format can be decoded:
+    integer PCM or 32 bits floating point.
+    */
+    static bool isFormatSupported(const WaveFormat& format);
+
     /*
     Close the Wave file and release resources.
     */
     void close();
 
-    // Audio file stream interface.
+    // Audio file stream interface, used if the file is not mapped.
     std::ifstream m_audioFile;
+
+    // The file mapped in memory.
+    MappedFile m_mappedFile;
 };
 }
 
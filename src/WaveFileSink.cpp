@@ -0,0 +1,120 @@
+#include "WaveFileSink.h"
+#include "DebugLog.h"
+#include <limits>
+
+#ifdef WIN32
+#include "UTFConvertion.h"
+#endif
+
+// Define CLASS_NAME to have the name of the class.
+const std::string CLASS_NAME = "WaveFileSink";
+
+namespace SAL
+{
+namespace
+{
+// Size of the RIFF, fmt and data headers.
+const uint32_t WAVE_HEADERS_SIZE = 44;
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 0x0003;
+
+void writeUInt16(std::ofstream& file, uint16_t value)
+{
+    char bytes[2] = {
+        static_cast<char>(value & 0xFF),
+        static_cast<char>((value >> 8) & 0xFF)};
+    file.write(bytes, 2);
+}
+
+void writeUInt32(std::ofstream& file, uint32_t value)
+{
+    char bytes[4] = {
+        static_cast<char>(value & 0xFF),
+        static_cast<char>((value >> 8) & 0xFF),
+        static_cast<char>((value >> 16) & 0xFF),
+        static_cast<char>((value >> 24) & 0xFF)};
+    file.write(bytes, 4);
+}
+}
+
+WaveFileSink::WaveFileSink(const std::string& filePath, double speed, size_t framesPerBuffer) :
+    ClockedAudioSink(speed, framesPerBuffer),
+    m_filePath(filePath),
+    m_numChannels(0),
+    m_sampleRate(0),
+    m_dataSize(0)
+{}
+
+WaveFileSink::~WaveFileSink()
+{
+    stop();
+}
+
+bool WaveFileSink::openOutput(int numChannels, size_t sampleRate)
+{
+    if (m_file.is_open())
+        m_file.close();
+
+#ifdef WIN32
+    m_file.open(UTFConvertion::toWString(m_filePath), std::fstream::binary | std::fstream::trunc);
+#else
+    m_file.open(m_filePath, std::fstream::binary | std::fstream::trunc);
+#endif
+    if (!m_file.is_open())
+    {
+        m_lastError = "cannot open " + m_filePath;
+        SAL_DEBUG_STREAM_STATUS("Opening WAVE file sink failed: cannot open " + m_filePath)
+
+        return false;
+    }
+
+    m_numChannels = static_cast<uint16_t>(numChannels);
+    m_sampleRate = static_cast<uint32_t>(sampleRate);
+    m_dataSize = 0;
+    writeHeaders();
+    return m_file.good();
+}
+
+void WaveFileSink::write(const float* samples, unsigned long frames)
+{
+    // The samples are written in the byte order of the host, like they are read.
+    std::streamsize size = static_cast<std::streamsize>(frames) * m_numChannels * sizeof(float);
+    m_file.write(reinterpret_cast<const char*>(samples), size);
+    m_dataSize += size;
+}
+
+void WaveFileSink::flush()
+{
+    if (!m_file.is_open())
+        return;
+
+    // Update the sizes and go back to the end of the data.
+    m_file.seekp(0);
+    writeHeaders();
+    m_file.seekp(0, std::ios::end);
+    m_file.flush();
+}
+
+void WaveFileSink::writeHeaders()
+{
+    // The sizes are 32 bits, a bigger file is truncated by the readers.
+    const uint32_t maxDataSize = std::numeric_limits<uint32_t>::max() - WAVE_HEADERS_SIZE;
+    uint32_t dataSize = m_dataSize < maxDataSize ? static_cast<uint32_t>(m_dataSize) : maxDataSize;
+    const uint16_t blockAlign = m_numChannels * sizeof(float);
+
+    m_file.write("RIFF", 4);
+    writeUInt32(m_file, WAVE_HEADERS_SIZE - 8 + dataSize);
+    m_file.write("WAVE", 4);
+
+    m_file.write("fmt ", 4);
+    writeUInt32(m_file, 16);
+    writeUInt16(m_file, WAVE_FORMAT_IEEE_FLOAT);
+    writeUInt16(m_file, m_numChannels);
+    writeUInt32(m_file, m_sampleRate);
+    writeUInt32(m_file, m_sampleRate * blockAlign);
+    writeUInt16(m_file, blockAlign);
+    writeUInt16(m_file, 32);
+
+    m_file.write("data", 4);
+    writeUInt32(m_file, dataSize);
+}
+}
@@ -0,0 +1,41 @@
+#ifndef SIMPLE_AUDIO_LIBRARY_WAVEFILESINK_H_
+#define SIMPLE_AUDIO_LIBRARY_WAVEFILESINK_H_
+
+#include "ClockedAudioSink.h"
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+namespace SAL
+{
+/*
+Sink writing the stream into a 32 bits floating point WAVE file.
+The file is rewritten each time a stream is opened, the sizes of
+the headers are updated each time the sink become inactive.
+*/
+class WaveFileSink : public ClockedAudioSink
+{
+public:
+    WaveFileSink(const std::string& filePath, double speed, size_t framesPerBuffer);
+    virtual ~WaveFileSink();
+
+protected:
+    virtual bool openOutput(int numChannels, size_t sampleRate) override;
+    virtual void write(const float* samples, unsigned long frames) override;
+    virtual void flush() override;
+
+private:
+    /*
+    Write the RIFF, fmt and data headers with the current data size.
+    */
+    void writeHeaders();
+
+    std::string m_filePath;
+    std::ofstream m_file;
+    uint16_t m_numChannels;
+    uint32_t m_sampleRate;
+    uint64_t m_dataSize;
+};
+}
+
+#endif // SIMPLE_AUDIO_LIBRARY_WAVEFILESINK_H_
@@ -0,0 +1,203 @@
+/*
+Check that the steady-state decode loop does not allocate.
+
+The global operator new is replaced to count the allocations. A
+generated WAVE file is streamed the way the player does it (read
+from the file, flush into the ring buffer, read the ring buffer)
+and the allocations are counted per decoded second, once the first
+second is decoded and the buffers are allocated.
+*/
+
+#include "AbstractAudioFile.h"
+#include "FormatProbe.h"
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// Duration of the generated files in seconds.
+#define FILE_DURATION 10
+
+// Sample rate of the generated files.
+#define FILE_SAMPLE_RATE 44100
+
+// Number of frames read from the ring buffer at once, the size of a stream callback.
+#define READ_FRAMES 512
+
+namespace
+{
+std::atomic<size_t> allocationCount(0);
+
+struct WaveFormat
+{
+    const char* name;
+    uint16_t formatTag;
+    uint16_t bitsPerSample;
+};
+
+const WaveFormat FORMATS[] = {
+    {"PCM 16 bits", 1, 16},
+    {"PCM 24 bits", 1, 24},
+    {"PCM 32 bits", 1, 32},
+    {"Float 32 bits", 3, 32}};
+
+void writeLE(std::ofstream& file, uint32_t value, int bytes)
+{
+    for (int b = 0; b < bytes; b++)
+        file.put(static_cast<char>((value >> (8 * b)) & 0xFF));
+}
+
+/*
+Write a stereo WAVE file of FILE_DURATION seconds with the format *format.
+*/
+bool writeWave(const std::string& filePath, const WaveFormat& format)
+{
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    const uint16_t numChannels = 2;
+    const uint16_t blockAlign = numChannels * format.bitsPerSample / 8;
+    const uint32_t dataSize = FILE_DURATION * FILE_SAMPLE_RATE * blockAlign;
+
+    file.write("RIFF", 4);
+    writeLE(file, 36 + dataSize, 4);
+    file.write("WAVEfmt ", 8);
+    writeLE(file, 16, 4);
+    writeLE(file, format.formatTag, 2);
+    writeLE(file, numChannels, 2);
+    writeLE(file, FILE_SAMPLE_RATE, 4);
+    writeLE(file, FILE_SAMPLE_RATE * blockAlign, 4);
+    writeLE(file, blockAlign, 2);
+    writeLE(file, format.bitsPerSample, 2);
+    file.write("data", 4);
+    writeLE(file, dataSize, 4);
+
+    // A slow ramp, the content does not matter.
+    const size_t samples = (size_t)FILE_DURATION * FILE_SAMPLE_RATE * numChannels;
+    for (size_t i = 0; i < samples; i++)
+    {
+        float value = (float)(i % 2000) / 1000.0f - 1.0f;
+        if (format.formatTag == 3)
+        {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            writeLE(file, bits, 4);
+        }
+        else
+        {
+            int32_t number = (int32_t)(value * ((1u << (format.bitsPerSample - 1)) - 1));
+            writeLE(file, (uint32_t)number, format.bitsPerSample / 8);
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+/*
+Stream the file *filePath until the end of the stream.
+Return the number of allocations per decoded second after the first second,
+or -1 if the file cannot be opened.
+*/
+double allocationsPerSecond(const std::string& filePath)
+{
+    std::unique_ptr<SAL::AbstractAudioFile> file(SAL::FormatProbe::open(filePath));
+    if (!file || !file->isOpen())
+        return -1.0;
+
+    file->setBufferingPolicy(SAL::BufferingPolicy());
+    std::vector<float> output(READ_FRAMES * file->numChannels());
+
+    size_t countStart = 0;
+    size_t countStartPos = 0;
+    bool isCounting = false;
+    while (!file->isEnded())
+    {
+        file->readFromFile();
+        file->flush();
+        file->read(reinterpret_cast<char*>(output.data()), READ_FRAMES);
+
+        // The buffers are allocated while the first second is decoded.
+        if (!isCounting && file->streamPos() >= file->sampleRate())
+        {
+            isCounting = true;
+            countStart = allocationCount;
+            countStartPos = file->streamPos();
+        }
+    }
+
+    if (!isCounting)
+        return 0.0;
+
+    const size_t allocations = allocationCount - countStart;
+    const double seconds = (double)(file->streamPos() - countStartPos) / file->sampleRate();
+    return seconds > 0.0 ? allocations / seconds : 0.0;
+}
+}
+
+void* operator new(size_t size)
+{
+    allocationCount++;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    allocationCount++;
+    if (void* p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main()
+{
+#ifndef USE_WAVE
+    std::printf("The WAVE reader is not compiled, nothing to check\n");
+    return 0;
+#else
+    const std::string filePath = "AllocationTest.wav";
+    bool isSuccess = true;
+    for (const WaveFormat& format : FORMATS)
+    {
+        if (!writeWave(filePath, format))
+        {
+            std::printf("Cannot write %s\n", filePath.c_str());
+            return 1;
+        }
+
+        double allocations = allocationsPerSecond(filePath);
+        std::printf("%s: %.2f allocations per decoded second\n", format.name, allocations);
+        if (allocations != 0.0)
+            isSuccess = false;
+    }
+    std::remove(filePath.c_str());
+    return isSuccess ? 0 : 1;
+#endif
+}
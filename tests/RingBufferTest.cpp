@@ -0,0 +1,196 @@
+/*
+Stress test of the single-producer/single-consumer RingBuffer.
+
+A producer thread write a sequence of bytes with write and
+reserveWrite/commitWrite, a consumer thread read it back with read
+and peekRead/consumeRead and check every byte. The chunk sizes are
+changing to exercise the wrap around at the end of the storage.
+A second pass call clear and resizeBuffer while both threads are
+running to exercise the quiesce protocol.
+*/
+
+#include "RingBuffer.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+// Number of chunks written and read by each thread.
+#define STRESS_ITERATIONS 4000000
+
+// Number of chunks written and read by each thread while the buffer is cleared and resized.
+#define QUIESCE_ITERATIONS 1000000
+
+// Size of the ring buffer, not a power of two to check the rounding.
+#define BUFFER_SIZE 1000
+
+// Byte written while the buffer is cleared and resized.
+#define QUIESCE_BYTE 0x5A
+
+// Largest chunk written or read at once.
+#define MAX_CHUNK_SIZE 97
+
+namespace
+{
+/*
+Byte at the position *pos of the sequence.
+*/
+inline char sequenceByte(size_t pos)
+{
+    return static_cast<char>((pos * 31 + (pos >> 8)) & 0xFF);
+}
+
+/*
+Size of the chunk number *i.
+*/
+inline size_t chunkSize(size_t i)
+{
+    return 1 + (i * 7919) % MAX_CHUNK_SIZE;
+}
+
+/*
+Write and read the sequence from two threads and check it.
+Return the number of bytes not matching the sequence.
+*/
+size_t runSequence(SAL::RingBuffer& ringBuffer)
+{
+    std::atomic<size_t> errors(0);
+
+    std::thread producer([&ringBuffer]() {
+        char chunk[MAX_CHUNK_SIZE];
+        size_t pos = 0;
+        for (size_t i = 0; i < STRESS_ITERATIONS; i++)
+        {
+            size_t size = chunkSize(i);
+            size_t written = 0;
+            if (i % 2 == 0)
+            {
+                for (size_t j = 0; j < size; j++)
+                    chunk[j] = sequenceByte(pos + j);
+                written = ringBuffer.write(chunk, size);
+            }
+            else
+            {
+                // Write directly inside the storage.
+                SAL::RingBufferSpans spans = ringBuffer.reserveWrite(size);
+                for (size_t j = 0; j < spans.firstSize; j++)
+                    spans.first[j] = sequenceByte(pos + j);
+                for (size_t j = 0; j < spans.secondSize; j++)
+                    spans.second[j] = sequenceByte(pos + spans.firstSize + j);
+                written = spans.size();
+                ringBuffer.commitWrite(written);
+            }
+            pos += written;
+            if (written == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    std::thread consumer([&ringBuffer, &errors]() {
+        char chunk[MAX_CHUNK_SIZE];
+        size_t pos = 0;
+        for (size_t i = 0; i < STRESS_ITERATIONS; i++)
+        {
+            size_t size = chunkSize(i * 3);
+            size_t readed = 0;
+            if (i % 2 == 0)
+            {
+                readed = ringBuffer.read(chunk, size);
+                for (size_t j = 0; j < readed; j++)
+                {
+                    if (chunk[j] != sequenceByte(pos + j))
+                        errors++;
+                }
+            }
+            else
+            {
+                // Read directly from the storage.
+                SAL::RingBufferSpans spans = ringBuffer.peekRead(size);
+                for (size_t j = 0; j < spans.firstSize; j++)
+                {
+                    if (spans.first[j] != sequenceByte(pos + j))
+                        errors++;
+                }
+                for (size_t j = 0; j < spans.secondSize; j++)
+                {
+                    if (spans.second[j] != sequenceByte(pos + spans.firstSize + j))
+                        errors++;
+                }
+                readed = spans.size();
+                ringBuffer.consumeRead(readed);
+            }
+            pos += readed;
+            if (readed == 0)
+                std::this_thread::yield();
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    return errors;
+}
+
+/*
+Write and read from two threads while a third one is
+clearing and resizing the buffer. The data is lost on each
+clear, only bytes written by the producer must be read.
+Return the number of bytes not written by the producer.
+*/
+size_t runQuiesce(SAL::RingBuffer& ringBuffer)
+{
+    std::atomic<size_t> errors(0);
+    std::atomic<bool> isRunning(true);
+
+    std::thread producer([&ringBuffer]() {
+        char chunk[MAX_CHUNK_SIZE];
+        memset(chunk, QUIESCE_BYTE, MAX_CHUNK_SIZE);
+        for (size_t i = 0; i < QUIESCE_ITERATIONS; i++)
+            ringBuffer.write(chunk, chunkSize(i));
+    });
+
+    std::thread consumer([&ringBuffer, &errors]() {
+        char chunk[MAX_CHUNK_SIZE];
+        for (size_t i = 0; i < QUIESCE_ITERATIONS; i++)
+        {
+            size_t readed = ringBuffer.read(chunk, chunkSize(i));
+            for (size_t j = 0; j < readed; j++)
+            {
+                if (chunk[j] != QUIESCE_BYTE)
+                    errors++;
+            }
+        }
+    });
+
+    std::thread quiescer([&ringBuffer, &isRunning]() {
+        for (size_t i = 0; isRunning; i++)
+        {
+            if (i % 2 == 0)
+                ringBuffer.clear();
+            else
+                ringBuffer.resizeBuffer(BUFFER_SIZE / 2 + (i % 4) * BUFFER_SIZE);
+            std::this_thread::yield();
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    isRunning = false;
+    quiescer.join();
+    return errors;
+}
+}
+
+int main()
+{
+    SAL::RingBuffer ringBuffer(BUFFER_SIZE);
+    std::printf("RingBuffer of %zu bytes, mirrored: %d\n", ringBuffer.size(), ringBuffer.isMirrored());
+
+    size_t sequenceErrors = runSequence(ringBuffer);
+    std::printf("Sequence: %zu errors\n", sequenceErrors);
+
+    ringBuffer.clear();
+    size_t quiesceErrors = runQuiesce(ringBuffer);
+    std::printf("Quiesce: %zu errors\n", quiesceErrors);
+
+    return sequenceErrors == 0 && quiesceErrors == 0 ? 0 : 1;
+}
@@ -0,0 +1,173 @@
+/*
+Check that every instructions set of the SampleConverter produce
+exactly the same floating point numbers than the scalar reference.
+
+The 8, 16 and 24 bits formats are checked on every possible value,
+the 32 bits formats on their limits and pseudo random values. The
+input is not aligned and every small size is checked to exercise
+the scalar tail of the vectorized kernels.
+*/
+
+#include "SampleConverter.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using SAL::SampleConverter;
+
+// Number of samples converted at once.
+#define BLOCK_SAMPLES 65536
+
+// Number of samples checked for the 32 bits formats.
+#define RANDOM_SAMPLES (64 * BLOCK_SAMPLES)
+
+// Largest size checked one sample at a time.
+#define MAX_TAIL_SAMPLES 67
+
+namespace
+{
+struct FormatInfo
+{
+    SampleConverter::Format format;
+    const char* name;
+    int bytesPerSample;
+};
+
+const FormatInfo FORMATS[] = {
+    {SampleConverter::Format::U8, "U8", 1},
+    {SampleConverter::Format::S8, "S8", 1},
+    {SampleConverter::Format::S16, "S16", 2},
+    {SampleConverter::Format::S24, "S24", 3},
+    {SampleConverter::Format::S32, "S32", 4},
+    {SampleConverter::Format::F32, "F32", 4}};
+
+// Limits of the 32 bits formats, and the infinities and NaN of the floating point numbers.
+const uint32_t EDGE_VALUES[] = {
+    0x00000000, 0x00000001, 0x7FFFFFFF, 0x80000000, 0x80000001, 0xFFFFFFFF,
+    0x3F800000, 0xBF800000, 0x7F800000, 0xFF800000, 0x7FC00000, 0x00800000};
+
+const char* instructionsName(SampleConverter::Instructions instructions)
+{
+    switch (instructions)
+    {
+    case SampleConverter::Instructions::SCALAR:
+        return "SCALAR";
+    case SampleConverter::Instructions::SSE2:
+        return "SSE2";
+    case SampleConverter::Instructions::AVX2:
+        return "AVX2";
+    case SampleConverter::Instructions::NEON:
+        return "NEON";
+    }
+    return "";
+}
+
+/*
+Bits of the sample number *i: every value in order for the formats
+smaller than 32 bits, the limits then pseudo random values otherwise.
+*/
+uint32_t sampleBits(const FormatInfo& info, size_t i)
+{
+    if (info.bytesPerSample < 4)
+        return static_cast<uint32_t>(i);
+
+    const size_t edgeCount = sizeof(EDGE_VALUES) / sizeof(EDGE_VALUES[0]);
+    if (i < edgeCount)
+        return EDGE_VALUES[i];
+
+    // SplitMix64 finalizer.
+    uint64_t z = i + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
+
+/*
+Write *samples little endian samples starting at the sample number *first.
+*/
+void fillInput(const FormatInfo& info, size_t first, size_t samples, char* input)
+{
+    for (size_t i = 0; i < samples; i++)
+    {
+        uint32_t bits = sampleBits(info, first + i);
+        for (int b = 0; b < info.bytesPerSample; b++)
+            input[i * info.bytesPerSample + b] = static_cast<char>((bits >> (8 * b)) & 0xFF);
+    }
+}
+
+/*
+Convert *samples samples of *input with *instructions and the scalar
+reference and compare the bits. Return true if they are the same.
+*/
+bool compare(const FormatInfo& info, SampleConverter::Instructions instructions,
+    const char* input, size_t samples, std::vector<float>& expected, std::vector<float>& output)
+{
+    // The output is offset by one number, it is not aligned either.
+    memset(expected.data(), 0, (samples + 1) * sizeof(float));
+    memset(output.data(), 0, (samples + 1) * sizeof(float));
+    SampleConverter::convert(info.format, input, expected.data() + 1, samples, SampleConverter::Instructions::SCALAR);
+    SampleConverter::convert(info.format, input, output.data() + 1, samples, instructions);
+    return memcmp(expected.data(), output.data(), (samples + 1) * sizeof(float)) == 0;
+}
+
+/*
+Check the format *info with *instructions.
+Return the number of blocks not matching the scalar reference.
+*/
+size_t checkFormat(const FormatInfo& info, SampleConverter::Instructions instructions)
+{
+    size_t errors = 0;
+    const size_t totalSamples = info.bytesPerSample < 4 ? (size_t)1 << (8 * info.bytesPerSample) : RANDOM_SAMPLES;
+
+    // The input is offset by one byte to not be aligned.
+    std::vector<char> storage((BLOCK_SAMPLES + MAX_TAIL_SAMPLES) * info.bytesPerSample + 1);
+    char* input = storage.data() + 1;
+    std::vector<float> expected(BLOCK_SAMPLES + MAX_TAIL_SAMPLES + 1);
+    std::vector<float> output(BLOCK_SAMPLES + MAX_TAIL_SAMPLES + 1);
+
+    for (size_t first = 0; first < totalSamples; first += BLOCK_SAMPLES)
+    {
+        size_t samples = std::min<size_t>(BLOCK_SAMPLES, totalSamples - first);
+        fillInput(info, first, samples, input);
+        if (!compare(info, instructions, input, samples, expected, output))
+        {
+            std::printf("%s %s: mismatch in the samples %zu to %zu\n",
+                info.name, instructionsName(instructions), first, first + samples);
+            errors++;
+        }
+    }
+
+    // Every small size, the vectorized kernels are converting the end with the scalar code.
+    fillInput(info, 0, MAX_TAIL_SAMPLES, input);
+    for (size_t samples = 0; samples <= MAX_TAIL_SAMPLES; samples++)
+    {
+        if (!compare(info, instructions, input, samples, expected, output))
+        {
+            std::printf("%s %s: mismatch with %zu samples\n",
+                info.name, instructionsName(instructions), samples);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+}
+
+int main()
+{
+    size_t errors = 0;
+    for (SampleConverter::Instructions instructions : SampleConverter::availableInstructions())
+    {
+        if (instructions == SampleConverter::Instructions::SCALAR)
+            continue;
+
+        std::printf("Checking %s\n", instructionsName(instructions));
+        for (const FormatInfo& info : FORMATS)
+            errors += checkFormat(info, instructions);
+    }
+
+    std::printf("%zu errors\n", errors);
+    return errors == 0 ? 0 : 1;
+}